@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////////////
+// batch_dp.cpp
+//
+// Definitions for soccer_dyn_prog_batch, the batch solver for many small
+// fields.
+//
+// Small fields are dominated by per-call overheads rather than by the DP
+// itself, so each field is validated and counted in a single pass over its
+// characters, straight from the strings, into a frontier buffer that each
+// thread keeps and reuses from one field to the next. The batch is split
+// into chunks of consecutive fields that run as tasks on the shared
+// ThreadPool, and each field's outcome is written to its own slot, so one
+// bad field does not affect the others.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "poly_exp.hpp"
+#include "count_arith.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+namespace {
+
+  // Chunks handed out per pool thread, so that work stealing can even out
+  // fields of different sizes.
+  const size_t CHUNKS_PER_THREAD = 8;
+
+  // Fewest fields per task, to keep the task overhead small.
+  const size_t MIN_CHUNK_FIELDS = 16;
+
+  // Validate field and count its routes in Arith, whose value_type is
+  // std::uint64_t, using frontier as scratch space.
+  template <typename Arith>
+  algorithms::BatchCount solve_field(const std::vector<std::string>& field,
+                                     std::vector<std::uint64_t>& frontier,
+                                     const Arith& arith) {
+    const algorithms::BatchCount invalid{0, algorithms::BatchStatus::invalid};
+    if (field.empty() || field[0].empty()) {
+      return invalid;
+    }
+    const size_t columns = field[0].size();
+    frontier.assign(columns, arith.zero());
+    frontier[0] = arith.one();
+    for (const auto& row : field) {
+      if (row.size() != columns) {
+        return invalid;
+      }
+      std::uint64_t left = arith.zero();
+      for (size_t j = 0; j < columns; ++j) {
+        if (row[j] == '.') {
+          arith.add_to(frontier[j], left);
+          left = frontier[j];
+        } else if (row[j] == 'X') {
+          frontier[j] = left = arith.zero();
+        } else {
+          return invalid;
+        }
+      }
+    }
+    return {frontier[columns - 1], algorithms::BatchStatus::ok};
+  }
+
+  // Solve fields[begin, end), reusing this thread's frontier buffer.
+  void solve_range(const std::vector<std::string>* fields, size_t begin,
+                   size_t end, algorithms::BatchCount* out,
+                   std::uint64_t modulus) {
+    thread_local std::vector<std::uint64_t> frontier;
+    if (modulus == 0) {
+      const algorithms::detail::saturating_u64 arith;
+      for (size_t k = begin; k < end; ++k) {
+        out[k] = solve_field(fields[k], frontier, arith);
+        if (out[k].status == algorithms::BatchStatus::ok &&
+            out[k].count == arith.SATURATED) {
+          out[k] = {0, algorithms::BatchStatus::overflow};
+        }
+      }
+    } else {
+      const algorithms::detail::mod_u64 arith(modulus);
+      for (size_t k = begin; k < end; ++k) {
+        out[k] = solve_field(fields[k], frontier, arith);
+      }
+    }
+  }
+
+}
+
+size_t algorithms::soccer_dyn_prog_batch(const std::vector<std::string>* fields,
+                                         size_t count, BatchCount* out,
+                                         std::uint64_t modulus) {
+  if (modulus != 0) {
+    detail::validate_modulus(modulus);
+  }
+
+  ThreadPool& pool = ThreadPool::shared();
+  const size_t threads = pool.size() + 1;
+  const size_t chunk = std::max(MIN_CHUNK_FIELDS,
+                                (count + threads * CHUNKS_PER_THREAD - 1)
+                                / (threads * CHUNKS_PER_THREAD));
+  if (count <= chunk) {
+    solve_range(fields, 0, count, out, modulus);
+  } else {
+    TaskGroup group(pool);
+    for (size_t begin = 0; begin < count; begin += chunk) {
+      const size_t end = std::min(begin + chunk, count);
+      group.run([=] { solve_range(fields, begin, end, out, modulus); });
+    }
+    group.wait();
+  }
+
+  return std::count_if(out, out + count, [](const BatchCount& result) {
+    return result.status == BatchStatus::ok;
+  });
+}
+
+size_t algorithms::soccer_dyn_prog_batch(
+    const std::vector<std::vector<std::string>>& fields,
+    std::vector<BatchCount>& out, std::uint64_t modulus) {
+  out.resize(fields.size());
+  return soccer_dyn_prog_batch(fields.data(), fields.size(), out.data(), modulus);
+}
@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////////
+// bench.cpp
+//
+// Google Benchmark suite for soccer_exhaustive and soccer_dyn_prog, over
+// n, aspect ratio and obstacle probability.
+//
+// Each benchmark is named
+//
+//    <algorithm>/n:<N>/aspect:<A>/x_probability:<P>
+//
+// where the field has r rows and about A * r columns with r + c - 2 = n,
+// and each cell other than the two corners is an X with probability 1 / P
+// (never when P is 0), as in timing.cpp. Fields come from a fixed seed, so
+// runs on different commits time the same fields.
+//
+// Besides the time, every benchmark reports
+//
+//    cells_per_second  r * c cells solved per second,
+//    allocs_per_call   heap allocations made by one call, and
+//    bytes_per_cell    peak heap bytes held during one call, per cell,
+//
+// the last two counted by the replacement operator new below during one
+// extra call after the timed loop.
+//
+// How to use:
+//
+//    $ make bench                      # writes bench.json
+//    $ ./poly_exp_bench --benchmark_filter='dyn_prog/n:1024'
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+#include "poly_exp.hpp"
+
+namespace {
+
+  const std::uint64_t FIELD_SEED = 42;
+
+  // Heap usage of the whole program. Every allocation stores its size in a
+  // header, so that operator delete can subtract it again.
+  struct HeapCounters {
+    std::atomic<std::uint64_t> allocations{0};
+    std::atomic<std::int64_t> live_bytes{0}, peak_bytes{0};
+
+    void reset() {
+      allocations = 0;
+      peak_bytes = live_bytes.load();
+    }
+  };
+
+  HeapCounters heap;
+
+  const size_t HEADER = alignof(std::max_align_t);
+
+  void* counted_new(size_t size) {
+    void* block = std::malloc(size + HEADER);
+    if (block == nullptr) {
+      throw std::bad_alloc();
+    }
+    *static_cast<size_t*>(block) = size;
+    heap.allocations.fetch_add(1, std::memory_order_relaxed);
+    const std::int64_t live =
+      heap.live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+    std::int64_t peak = heap.peak_bytes.load(std::memory_order_relaxed);
+    while (live > peak &&
+           !heap.peak_bytes.compare_exchange_weak(peak, live,
+                                                  std::memory_order_relaxed)) {
+    }
+    return static_cast<char*>(block) + HEADER;
+  }
+
+  void counted_delete(void* pointer) {
+    if (pointer == nullptr) {
+      return;
+    }
+    void* block = static_cast<char*>(pointer) - HEADER;
+    heap.live_bytes.fetch_sub(*static_cast<size_t*>(block),
+                              std::memory_order_relaxed);
+    std::free(block);
+  }
+
+  // A random field with n = r + c - 2 and c close to aspect * r.
+  std::vector<std::string> make_field(size_t n, size_t aspect,
+                                      size_t x_probability) {
+    const size_t r = std::max<size_t>(1, (n + 2) / (aspect + 1)),
+                 c = n + 2 - r;
+    std::vector<std::string> field(r, std::string(c, '.'));
+    if (x_probability != 0) {
+      std::mt19937_64 rng(FIELD_SEED);
+      std::uniform_int_distribution<size_t> cell(0, x_probability - 1);
+      for (auto& row : field) {
+        for (auto& ch : row) {
+          if (cell(rng) == 0) {
+            ch = 'X';
+          }
+        }
+      }
+    }
+    field[0][0] = field[r - 1][c - 1] = '.';
+    return field;
+  }
+
+  template <typename Solve>
+  void run(benchmark::State& state, Solve solve) {
+    const auto field = make_field(state.range(0), state.range(1), state.range(2));
+    const double cells = double(field.size()) * field[0].size();
+
+    for (auto _ : state) {
+      benchmark::DoNotOptimize(solve(field));
+    }
+
+    heap.reset();
+    const std::int64_t before = heap.live_bytes.load();
+    benchmark::DoNotOptimize(solve(field));
+
+    state.counters["cells_per_second"] =
+      benchmark::Counter(cells, benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["allocs_per_call"] = double(heap.allocations.load());
+    state.counters["bytes_per_cell"] = (heap.peak_bytes.load() - before) / cells;
+  }
+
+  void BM_soccer_exhaustive(benchmark::State& state) {
+    run(state, [](const std::vector<std::string>& field) {
+      return algorithms::soccer_exhaustive(field);
+    });
+  }
+
+  void BM_soccer_dyn_prog(benchmark::State& state) {
+    run(state, [](const std::vector<std::string>& field) {
+      return algorithms::soccer_dyn_prog(field);
+    });
+  }
+
+}
+
+void* operator new(size_t size) { return counted_new(size); }
+void* operator new[](size_t size) { return counted_new(size); }
+void operator delete(void* pointer) noexcept { counted_delete(pointer); }
+void operator delete[](void* pointer) noexcept { counted_delete(pointer); }
+void operator delete(void* pointer, size_t) noexcept { counted_delete(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { counted_delete(pointer); }
+
+// soccer_exhaustive is limited to n <= 31
+BENCHMARK(BM_soccer_exhaustive)
+  ->Name("soccer_exhaustive")
+  ->ArgNames({"n", "aspect", "x_probability"})
+  ->ArgsProduct({{16, 20, 24, 28}, {1, 8}, {0, 20, 5}})
+  ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_soccer_dyn_prog)
+  ->Name("soccer_dyn_prog")
+  ->ArgNames({"n", "aspect", "x_probability"})
+  ->ArgsProduct({{64, 256, 1024, 4096}, {1, 8}, {0, 20, 5}})
+  ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
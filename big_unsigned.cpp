@@ -0,0 +1,131 @@
+///////////////////////////////////////////////////////////////////////////////
+// big_unsigned.cpp
+//
+// Definitions for BigUnsigned.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "big_unsigned.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+namespace {
+
+  // Number of limbs summed per carry-free block in operator+=.
+  const size_t ADD_BLOCK = 8;
+
+}
+
+algorithms::BigUnsigned::BigUnsigned(std::uint64_t value) {
+  if (value != 0) {
+    _limbs.push_back(value);
+  }
+}
+
+algorithms::BigUnsigned::BigUnsigned(unsigned __int128 value) {
+  _limbs.push_back(static_cast<std::uint64_t>(value));
+  _limbs.push_back(static_cast<std::uint64_t>(value >> 64));
+  trim();
+}
+
+void algorithms::BigUnsigned::trim() {
+  while (!_limbs.empty() && _limbs.back() == 0) {
+    _limbs.pop_back();
+  }
+}
+
+std::uint64_t algorithms::BigUnsigned::to_u64() const {
+  assert(fits_u64());
+  return _limbs.empty() ? 0 : _limbs[0];
+}
+
+algorithms::BigUnsigned&
+algorithms::BigUnsigned::operator+=(const BigUnsigned& other) {
+  const size_t n = other._limbs.size();
+  if (_limbs.size() < n) {
+    _limbs.resize(n, 0);
+  }
+  std::uint64_t* a = _limbs.data();
+  const std::uint64_t* b = other._limbs.data();
+
+  std::uint64_t carry = 0;
+  for (size_t base = 0; base < n; base += ADD_BLOCK) {
+    const size_t len = std::min(ADD_BLOCK, n - base);
+    // Pass 1: independent lane sums and carry-outs, no loop-carried
+    // dependency, so this vectorizes.
+    std::uint64_t out[ADD_BLOCK];
+    for (size_t k = 0; k < len; ++k) {
+      std::uint64_t s = a[base + k] + b[base + k];
+      out[k] = s < b[base + k];
+      a[base + k] = s;
+    }
+    // Pass 2: ripple the block's carries. A carry into a limb can only
+    // propagate further if that limb becomes zero.
+    for (size_t k = 0; k < len; ++k) {
+      std::uint64_t s = a[base + k] + carry;
+      carry = out[k] | (s < carry);
+      a[base + k] = s;
+    }
+  }
+  for (size_t i = n; carry != 0 && i < _limbs.size(); ++i) {
+    _limbs[i] += 1;
+    carry = (_limbs[i] == 0);
+  }
+  if (carry != 0) {
+    _limbs.push_back(1);
+  }
+  return *this;
+}
+
+void algorithms::BigUnsigned::mul_add_small(std::uint64_t factor,
+                                            std::uint64_t addend) {
+  std::uint64_t carry = addend;
+  for (auto& limb : _limbs) {
+    unsigned __int128 product =
+      static_cast<unsigned __int128>(limb) * factor + carry;
+    limb = static_cast<std::uint64_t>(product);
+    carry = static_cast<std::uint64_t>(product >> 64);
+  }
+  if (carry != 0) {
+    _limbs.push_back(carry);
+  }
+  trim();
+}
+
+std::uint64_t algorithms::BigUnsigned::mod_small(std::uint64_t divisor) const {
+  assert(divisor != 0);
+  unsigned __int128 remainder = 0;
+  for (size_t i = _limbs.size(); i-- > 0; ) {
+    remainder = ((remainder << 64) | _limbs[i]) % divisor;
+  }
+  return static_cast<std::uint64_t>(remainder);
+}
+
+std::string algorithms::BigUnsigned::to_string() const {
+  if (is_zero()) {
+    return "0";
+  }
+  // Peel off 19 decimal digits at a time.
+  const std::uint64_t CHUNK = 10000000000000000000ULL;
+  std::vector<std::uint64_t> digits = _limbs, chunks;
+  while (!digits.empty()) {
+    unsigned __int128 remainder = 0;
+    for (size_t i = digits.size(); i-- > 0; ) {
+      unsigned __int128 current = (remainder << 64) | digits[i];
+      digits[i] = static_cast<std::uint64_t>(current / CHUNK);
+      remainder = current % CHUNK;
+    }
+    chunks.push_back(static_cast<std::uint64_t>(remainder));
+    while (!digits.empty() && digits.back() == 0) {
+      digits.pop_back();
+    }
+  }
+  std::string result = std::to_string(chunks.back());
+  for (size_t i = chunks.size() - 1; i-- > 0; ) {
+    std::string part = std::to_string(chunks[i]);
+    result += std::string(19 - part.size(), '0') + part;
+  }
+  return result;
+}
@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////////
+// big_unsigned.hpp
+//
+// Arbitrary-precision unsigned integer used for exact path counts.
+//
+// Only the operations the counting algorithms need are provided. Limbs are
+// 64-bit words stored least significant first.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace algorithms {
+
+  class BigUnsigned {
+  private:
+    // Least significant limb first, never has trailing (most significant)
+    // zero limbs, so zero is the empty vector.
+    std::vector<std::uint64_t> _limbs;
+
+    void trim();
+
+  public:
+
+    BigUnsigned() = default;
+
+    BigUnsigned(std::uint64_t value);
+
+    BigUnsigned(unsigned __int128 value);
+
+    // Set to zero without releasing the limb storage.
+    void clear() { _limbs.clear(); }
+
+    bool is_zero() const { return _limbs.empty(); }
+
+    const std::vector<std::uint64_t>& limbs() const { return _limbs; }
+
+    // Return true when the value fits in a std::uint64_t.
+    bool fits_u64() const { return _limbs.size() <= 1; }
+
+    // Return the value as a std::uint64_t. The value must fit.
+    std::uint64_t to_u64() const;
+
+    // this += other. The limb sums are computed in a carry-free pass that the
+    // compiler can vectorize, and the carries are then rippled in a second,
+    // usually very short, pass.
+    BigUnsigned& operator+=(const BigUnsigned& other);
+
+    // this = this * factor + addend, for single-limb factor and addend.
+    void mul_add_small(std::uint64_t factor, std::uint64_t addend);
+
+    // Return this mod divisor, for a nonzero single-limb divisor.
+    std::uint64_t mod_small(std::uint64_t divisor) const;
+
+    // Return the decimal representation.
+    std::string to_string() const;
+
+    friend bool operator==(const BigUnsigned& a, const BigUnsigned& b) {
+      return a._limbs == b._limbs;
+    }
+
+    friend bool operator!=(const BigUnsigned& a, const BigUnsigned& b) {
+      return !(a == b);
+    }
+  };
+
+  inline BigUnsigned operator+(BigUnsigned a, const BigUnsigned& b) {
+    a += b;
+    return a;
+  }
+
+}
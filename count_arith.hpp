@@ -0,0 +1,142 @@
+///////////////////////////////////////////////////////////////////////////////
+// count_arith.hpp
+//
+// Counting policies ("result modes") shared by the dynamic programming
+// solvers. This header is an implementation detail of the algorithms and is
+// not part of the public interface declared in poly_exp.hpp.
+//
+// Every policy provides
+//
+//   value_type           the count type stored in DP tables
+//   zero(), one()        the additive and "one route" counts
+//   add_to(dst, src)     dst += src, in the policy's arithmetic
+//
+// and the 64-bit policies also
+//
+//   add_product(dst, a, b)   dst += a * b, for the transfer matrices of
+//                            soccer_repeated
+//
+// The saturating policies clamp at their maximum value instead of wrapping.
+// Path counts only ever grow along a path, so a saturated goal count means
+// the true count does not fit, while an unsaturated goal count is exact even
+// if some dead-end cell elsewhere saturated.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "big_unsigned.hpp"
+
+namespace algorithms {
+  namespace detail {
+
+    // Counts modulo 2^64.
+    struct wrap_u64 {
+      using value_type = std::uint64_t;
+      value_type zero() const { return 0; }
+      value_type one() const { return 1; }
+      void add_to(value_type& dst, value_type src) const { dst += src; }
+      void add_product(value_type& dst, value_type a, value_type b) const {
+        dst += a * b;
+      }
+    };
+
+    // Exact 64-bit counts, clamped at UINT64_MAX.
+    struct saturating_u64 {
+      using value_type = std::uint64_t;
+      static constexpr value_type SATURATED =
+        std::numeric_limits<std::uint64_t>::max();
+      value_type zero() const { return 0; }
+      value_type one() const { return 1; }
+      void add_to(value_type& dst, value_type src) const {
+        if (__builtin_add_overflow(dst, src, &dst)) {
+          dst = SATURATED;
+        }
+      }
+      void add_product(value_type& dst, value_type a, value_type b) const {
+        value_type product;
+        if (__builtin_mul_overflow(a, b, &product)) {
+          dst = SATURATED;
+        } else {
+          add_to(dst, product);
+        }
+      }
+    };
+
+    // Exact 128-bit counts, clamped at the maximum unsigned __int128.
+    struct saturating_u128 {
+      using value_type = unsigned __int128;
+      static constexpr value_type SATURATED = ~static_cast<value_type>(0);
+      value_type zero() const { return 0; }
+      value_type one() const { return 1; }
+      void add_to(value_type& dst, value_type src) const {
+        value_type sum = dst + src;
+        dst = (sum < src) ? SATURATED : sum;
+      }
+    };
+
+    // Counts modulo a caller-supplied modulus below 2^63, so that the sum of
+    // two residues never wraps.
+    struct mod_u64 {
+      using value_type = std::uint64_t;
+      std::uint64_t modulus;
+      explicit mod_u64(std::uint64_t m) : modulus(m) {}
+      value_type zero() const { return 0; }
+      value_type one() const { return 1 % modulus; }
+      void add_to(value_type& dst, value_type src) const {
+        dst += src;
+        if (dst >= modulus) {
+          dst -= modulus;
+        }
+      }
+      void add_product(value_type& dst, value_type a, value_type b) const {
+        dst = static_cast<value_type>(
+          (static_cast<unsigned __int128>(a) * b + dst) % modulus);
+      }
+    };
+
+    // Exact counts of any size.
+    struct exact_big {
+      using value_type = BigUnsigned;
+      value_type zero() const { return BigUnsigned(); }
+      value_type one() const { return BigUnsigned(std::uint64_t{1}); }
+      void add_to(value_type& dst, const value_type& src) const { dst += src; }
+    };
+
+    // Throws std::invalid_argument for moduli mod_u64 cannot use.
+    inline void validate_modulus(std::uint64_t modulus) {
+      if (modulus < 2 || modulus >= (std::uint64_t{1} << 63)) {
+        throw std::invalid_argument("Invalid, modulus");
+      }
+    }
+
+    // The modulus convention of the 64-bit solvers: call count(policy) with
+    // saturating_u64 when modulus is 0, and with mod_u64(modulus) otherwise.
+    // Throws std::overflow_error if the saturating count did not fit.
+    template <typename Count>
+    std::uint64_t count_with_modulus(std::uint64_t modulus, Count count) {
+      if (modulus == 0) {
+        std::uint64_t result = count(saturating_u64());
+        if (result == saturating_u64::SATURATED) {
+          throw std::overflow_error("Overflow, count does not fit in 64 bits");
+        }
+        return result;
+      }
+      validate_modulus(modulus);
+      return count(mod_u64(modulus));
+    }
+
+    // The number below the product of the pairwise coprime moduli that is
+    // residues[k] modulo moduli[k] for every k, by Garner's algorithm.
+    //
+    // Throws std::invalid_argument if the moduli are not coprime.
+    BigUnsigned crt_combine(const std::vector<std::uint64_t>& residues,
+                            const std::vector<std::uint64_t>& moduli);
+
+  }
+}
@@ -0,0 +1,444 @@
+///////////////////////////////////////////////////////////////////////////////
+// dp_kernels.cpp
+//
+// Definitions for the DP line kernels, LineSource and RouteSpans.
+//
+// The SIMD kernels process a line in chunks of 4 (AVX2) or 2 (SSE2) cells.
+// Within a chunk the segmented prefix sum is a log-step scan: each lane adds
+// the lane 1 to its left, then the lane 2 to its left, but only while the
+// cells in between are passable. Impassable lanes are zeroed on load, so they
+// contribute nothing and receive nothing. The running count from the
+// previous chunk is then added to the lanes whose prefix of the chunk is
+// entirely passable, and the last lane becomes the next chunk's carry.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dp_kernels.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+  using algorithms::detail::mod_u64;
+  using algorithms::detail::saturating_u64;
+  using algorithms::detail::wrap_u64;
+
+  // Lane masks for the 16 possible passable patterns of a 4-cell chunk.
+  struct ChunkMasks {
+    // lane k is passable
+    alignas(32) std::uint64_t open[16][4];
+    // lane k takes lane k - 1 (step 1 of the scan)
+    alignas(32) std::uint64_t step1[16][4];
+    // lane k takes lane k - 2 (step 2 of the scan)
+    alignas(32) std::uint64_t step2[16][4];
+    // lane k takes the carry from the previous chunk
+    alignas(32) std::uint64_t carry[16][4];
+
+    ChunkMasks() {
+      for (unsigned n = 0; n < 16; ++n) {
+        bool prefix = true;
+        for (unsigned k = 0; k < 4; ++k) {
+          bool here = (n >> k) & 1;
+          bool before = (k >= 1) && ((n >> (k - 1)) & 1);
+          prefix = prefix && here;
+          open[n][k] = here ? ~std::uint64_t{0} : 0;
+          step1[n][k] = (k >= 1 && here) ? ~std::uint64_t{0} : 0;
+          step2[n][k] = (k >= 2 && here && before) ? ~std::uint64_t{0} : 0;
+          carry[n][k] = prefix ? ~std::uint64_t{0} : 0;
+        }
+      }
+    }
+  };
+
+  const ChunkMasks CHUNK_MASKS;
+
+#if defined(__x86_64__)
+
+  __attribute__((target("avx2")))
+  __m256i mask(const std::uint64_t (&lanes)[4]) {
+    return _mm256_load_si256(reinterpret_cast<const __m256i*>(lanes));
+  }
+
+  // Vector additions in each counting policy's arithmetic. The modulus is
+  // below 2^63 and both operands are reduced, so sums never wrap.
+
+  struct avx2_wrap {
+    explicit avx2_wrap(const wrap_u64&) {}
+    __attribute__((target("avx2")))
+    __m256i add(__m256i a, __m256i b) const { return _mm256_add_epi64(a, b); }
+  };
+
+  struct avx2_saturating {
+    explicit avx2_saturating(const saturating_u64&) {}
+    __attribute__((target("avx2")))
+    __m256i add(__m256i a, __m256i b) const {
+      const __m256i bias = _mm256_set1_epi64x(static_cast<long long>(1ULL << 63));
+      __m256i sum = _mm256_add_epi64(a, b);
+      // unsigned a > sum means the addition wrapped
+      __m256i wrapped = _mm256_cmpgt_epi64(_mm256_xor_si256(a, bias),
+                                           _mm256_xor_si256(sum, bias));
+      return _mm256_or_si256(sum, wrapped);
+    }
+  };
+
+  struct avx2_mod {
+    std::uint64_t modulus;
+    explicit avx2_mod(const mod_u64& arith) : modulus(arith.modulus) {}
+    __attribute__((target("avx2")))
+    __m256i add(__m256i a, __m256i b) const {
+      const __m256i bias = _mm256_set1_epi64x(static_cast<long long>(1ULL << 63));
+      const __m256i m = _mm256_set1_epi64x(static_cast<long long>(modulus));
+      __m256i sum = _mm256_add_epi64(a, b);
+      // subtract the modulus where sum >= modulus, i.e. not modulus > sum
+      __m256i below = _mm256_cmpgt_epi64(_mm256_xor_si256(m, bias),
+                                         _mm256_xor_si256(sum, bias));
+      return _mm256_sub_epi64(sum, _mm256_andnot_si256(below, m));
+    }
+  };
+
+  template <typename Op, typename Arith>
+  __attribute__((target("avx2")))
+  void update_line_avx2(const std::uint64_t* open, std::uint64_t* frontier,
+                        size_t length, std::uint64_t left, const Arith& arith) {
+    const Op op(arith);
+    __m256i carry = _mm256_set1_epi64x(static_cast<long long>(left));
+    size_t k = 0;
+    // Two 4-lane chunks per iteration. Both are scanned independently, then
+    // joined, so the only serial dependency between iterations is the
+    // carry: next carry = last lane + (carry if all 8 cells are passable).
+    for (; k + 8 <= length; k += 8) {
+      unsigned n = (open[k / 64] >> (k % 64)) & 255;
+      __m256i* out = reinterpret_cast<__m256i*>(frontier + k);
+      if (n == 0) {
+        _mm256_storeu_si256(out, _mm256_setzero_si256());
+        _mm256_storeu_si256(out + 1, _mm256_setzero_si256());
+        carry = _mm256_setzero_si256();
+        continue;
+      }
+      const unsigned n0 = n & 15, n1 = n >> 4;
+      __m256i lo = _mm256_and_si256(_mm256_loadu_si256(out), mask(CHUNK_MASKS.open[n0]));
+      __m256i hi = _mm256_and_si256(_mm256_loadu_si256(out + 1), mask(CHUNK_MASKS.open[n1]));
+      // lanes (x, v0, v1, v2), then (x, x, v0, v1)
+      lo = op.add(lo, _mm256_and_si256(_mm256_permute4x64_epi64(lo, 0x90),
+                                       mask(CHUNK_MASKS.step1[n0])));
+      hi = op.add(hi, _mm256_and_si256(_mm256_permute4x64_epi64(hi, 0x90),
+                                       mask(CHUNK_MASKS.step1[n1])));
+      lo = op.add(lo, _mm256_and_si256(_mm256_permute4x64_epi64(lo, 0x40),
+                                       mask(CHUNK_MASKS.step2[n0])));
+      hi = op.add(hi, _mm256_and_si256(_mm256_permute4x64_epi64(hi, 0x40),
+                                       mask(CHUNK_MASKS.step2[n1])));
+      const __m256i carry_lo = mask(CHUNK_MASKS.carry[n0]);
+      const __m256i carry_hi = mask(CHUNK_MASKS.carry[n1]);
+      hi = op.add(hi, _mm256_and_si256(_mm256_permute4x64_epi64(lo, 0xFF), carry_hi));
+      // lane 3 of a carry mask is set only when the whole chunk is passable
+      const __m256i lo_through = _mm256_permute4x64_epi64(carry_lo, 0xFF);
+      const __m256i through = _mm256_and_si256(lo_through,
+                                               _mm256_permute4x64_epi64(carry_hi, 0xFF));
+      const __m256i next = op.add(_mm256_permute4x64_epi64(hi, 0xFF),
+                                  _mm256_and_si256(carry, through));
+      lo = op.add(lo, _mm256_and_si256(carry, carry_lo));
+      hi = op.add(hi, _mm256_and_si256(carry, _mm256_and_si256(carry_hi, lo_through)));
+      _mm256_storeu_si256(out, lo);
+      _mm256_storeu_si256(out + 1, hi);
+      carry = next;
+    }
+    if (k < length) {
+      // fewer than 8 cells left; finish with the generic kernel, reading
+      // bits from the word holding cell k
+      std::uint64_t tail[1] = { open[k / 64] >> (k % 64) };
+      std::uint64_t tail_left = (k == 0) ? left : frontier[k - 1];
+      algorithms::detail::update_line<Arith>(tail, frontier + k, length - k,
+                                             tail_left, arith);
+    }
+  }
+
+  // SSE2 has no 64-bit comparisons, so the wrap and reduction tests use the
+  // carry-out bit of the addition, (a & b) | ((a | b) & ~sum), broadcast
+  // from bit 63 to the whole lane.
+
+  __m128i sign_to_mask(__m128i x) {
+    return _mm_shuffle_epi32(_mm_srai_epi32(x, 31), 0xF5);
+  }
+
+  struct sse2_wrap {
+    explicit sse2_wrap(const wrap_u64&) {}
+    __m128i add(__m128i a, __m128i b) const { return _mm_add_epi64(a, b); }
+  };
+
+  struct sse2_saturating {
+    explicit sse2_saturating(const saturating_u64&) {}
+    __m128i add(__m128i a, __m128i b) const {
+      __m128i sum = _mm_add_epi64(a, b);
+      __m128i carry_out = _mm_or_si128(_mm_and_si128(a, b),
+                                       _mm_andnot_si128(sum, _mm_or_si128(a, b)));
+      return _mm_or_si128(sum, sign_to_mask(carry_out));
+    }
+  };
+
+  struct sse2_mod {
+    std::uint64_t modulus;
+    explicit sse2_mod(const mod_u64& arith) : modulus(arith.modulus) {}
+    __m128i add(__m128i a, __m128i b) const {
+      const __m128i m = _mm_set1_epi64x(static_cast<long long>(modulus));
+      __m128i sum = _mm_add_epi64(a, b);
+      __m128i reduced = _mm_sub_epi64(sum, m);
+      // borrow-out of sum - m, set exactly when sum < m
+      __m128i borrow = _mm_or_si128(_mm_andnot_si128(sum, m),
+                                    _mm_andnot_si128(_mm_xor_si128(sum, m), reduced));
+      __m128i below = sign_to_mask(borrow);
+      return _mm_or_si128(_mm_and_si128(below, sum), _mm_andnot_si128(below, reduced));
+    }
+  };
+
+  template <typename Op, typename Arith>
+  void update_line_sse2(const std::uint64_t* open, std::uint64_t* frontier,
+                        size_t length, std::uint64_t left, const Arith& arith) {
+    const Op op(arith);
+    __m128i carry = _mm_set1_epi64x(static_cast<long long>(left));
+    size_t k = 0;
+    for (; k + 2 <= length; k += 2) {
+      unsigned n = (open[k / 64] >> (k % 64)) & 3;
+      __m128i* out = reinterpret_cast<__m128i*>(frontier + k);
+      // the low halves of the 4-lane masks serve the 2-lane chunk
+      __m128i lane_open = _mm_load_si128(reinterpret_cast<const __m128i*>(CHUNK_MASKS.open[n]));
+      __m128i lane_step1 = _mm_load_si128(reinterpret_cast<const __m128i*>(CHUNK_MASKS.step1[n]));
+      __m128i lane_carry = _mm_load_si128(reinterpret_cast<const __m128i*>(CHUNK_MASKS.carry[n]));
+      __m128i v = _mm_and_si128(_mm_loadu_si128(out), lane_open);
+      v = op.add(v, _mm_and_si128(_mm_slli_si128(v, 8), lane_step1));
+      v = op.add(v, _mm_and_si128(carry, lane_carry));
+      _mm_storeu_si128(out, v);
+      carry = _mm_unpackhi_epi64(v, v);
+    }
+    if (k < length) {
+      std::uint64_t tail[1] = { open[k / 64] >> (k % 64) };
+      std::uint64_t tail_left = (k == 0) ? left : frontier[k - 1];
+      algorithms::detail::update_line<Arith>(tail, frontier + k, length - k,
+                                             tail_left, arith);
+    }
+  }
+
+#endif
+
+  // Each policy's kernel, picked once for the host CPU.
+  template <typename Arith>
+  using kernel = void (*)(const std::uint64_t*, std::uint64_t*, size_t,
+                          std::uint64_t, const Arith&);
+
+  template <typename Arith>
+  void update_line_scalar(const std::uint64_t* open, std::uint64_t* frontier,
+                          size_t length, std::uint64_t left, const Arith& arith) {
+    algorithms::detail::update_line<Arith>(open, frontier, length, left, arith);
+  }
+
+  bool has_avx2() {
+#if defined(__x86_64__)
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+  }
+
+  template <typename Arith, typename Avx2, typename Sse2>
+  kernel<Arith> select_kernel() {
+#if defined(__x86_64__)
+    if (has_avx2()) {
+      return update_line_avx2<Avx2, Arith>;
+    }
+    return update_line_sse2<Sse2, Arith>;
+#else
+    return update_line_scalar<Arith>;
+#endif
+  }
+
+}
+
+void algorithms::detail::update_line(const std::uint64_t* open,
+                                     std::uint64_t* frontier,
+                                     size_t length, std::uint64_t left,
+                                     const wrap_u64& arith) {
+  static const kernel<wrap_u64> selected =
+    select_kernel<wrap_u64, avx2_wrap, sse2_wrap>();
+  selected(open, frontier, length, left, arith);
+}
+
+void algorithms::detail::update_line(const std::uint64_t* open,
+                                     std::uint64_t* frontier,
+                                     size_t length, std::uint64_t left,
+                                     const saturating_u64& arith) {
+  static const kernel<saturating_u64> selected =
+    select_kernel<saturating_u64, avx2_saturating, sse2_saturating>();
+  selected(open, frontier, length, left, arith);
+}
+
+void algorithms::detail::update_line(const std::uint64_t* open,
+                                     std::uint64_t* frontier,
+                                     size_t length, std::uint64_t left,
+                                     const mod_u64& arith) {
+  static const kernel<mod_u64> selected =
+    select_kernel<mod_u64, avx2_mod, sse2_mod>();
+  selected(open, frontier, length, left, arith);
+}
+
+const char* algorithms::detail::update_line_isa() {
+#if defined(__x86_64__)
+  return has_avx2() ? "avx2" : "sse2";
+#else
+  return "scalar";
+#endif
+}
+
+void algorithms::detail::transpose64(std::uint64_t rows[64]) {
+  // Swap ever smaller off-diagonal blocks: the high 32 columns of rows
+  // 0..31 with the low 32 columns of rows 32..63, then 16x16 blocks, and
+  // so on down to single bits.
+  std::uint64_t mask = 0x00000000FFFFFFFFULL;
+  for (unsigned width = 32; width != 0; width >>= 1, mask ^= mask << width) {
+    for (unsigned k = 0; k < 64; k = ((k | width) + 1) & ~width) {
+      std::uint64_t swap = ((rows[k] >> width) ^ rows[k | width]) & mask;
+      rows[k] ^= swap << width;
+      rows[k | width] ^= swap;
+    }
+  }
+}
+
+algorithms::detail::LineSource::LineSource(const PackedField& field)
+  : _field(field),
+    _by_column(field.columns() > field.rows()),
+    _strip_stride(0),
+    _strip_index(SIZE_MAX) {
+  if (_by_column) {
+    size_t words = (field.rows() + 63) / 64;
+    _strip_stride = (words + PackedField::WORD_ALIGN - 1)
+                    / PackedField::WORD_ALIGN * PackedField::WORD_ALIGN;
+    _strip.assign(64 * _strip_stride, 0);
+  }
+}
+
+size_t algorithms::detail::LineSource::lines() const {
+  return _by_column ? _field.columns() : _field.rows();
+}
+
+size_t algorithms::detail::LineSource::length() const {
+  return _by_column ? _field.rows() : _field.columns();
+}
+
+const std::uint64_t* algorithms::detail::LineSource::line(size_t a) {
+  if (!_by_column) {
+    return _field.row(a);
+  }
+  const size_t lane = a % 64, word = a / 64;
+  if (word != _strip_index) {
+    // transpose the strip of columns 64 * word.. 64 * word + 63, 64 rows
+    // at a time
+    const size_t rows = _field.rows();
+    std::uint64_t block[64];
+    for (size_t base = 0; base < rows; base += 64) {
+      const size_t count = std::min<size_t>(64, rows - base);
+      for (size_t t = 0; t < 64; ++t) {
+        block[t] = (t < count) ? _field.row(base + t)[word] : 0;
+      }
+      transpose64(block);
+      for (size_t t = 0; t < 64; ++t) {
+        _strip[t * _strip_stride + base / 64] = block[t];
+      }
+    }
+    _strip_index = word;
+  }
+  return &_strip[lane * _strip_stride];
+}
+
+namespace {
+
+  // Move the cells reached on one line into the next, whose word w is
+  // open(w): the open ones among them are the seeds, which spread
+  // rightward through the runs of open cells that hold them. The sum
+  // open + seeds flips the cells from each seed up to the end of its run,
+  // and the carry out of a run's end moves on into the next word.
+  //
+  // reach is zero outside its words [first, end), and so only those words
+  // and the ones a carry runs into are touched. Returns whether any cell
+  // is reached.
+  template <typename Open>
+  bool advance(Open open, std::vector<std::uint64_t>& reach,
+               size_t& first, size_t& end) {
+    bool carry = false;
+    size_t w = first;
+    for (; w < end || (carry && w < reach.size()); ++w) {
+      const std::uint64_t o = open(w), seeds = reach[w] & o;
+      unsigned long long sum;
+      const bool low = __builtin_uaddll_overflow(o, seeds, &sum);
+      const bool high = __builtin_uaddll_overflow(sum, carry, &sum);
+      reach[w] = ((sum ^ o ^ seeds) | seeds) & o;
+      carry = low || high;
+    }
+    end = w;
+    while (first < end && reach[first] == 0) {
+      ++first;
+    }
+    while (end > first && reach[end - 1] == 0) {
+      --end;
+    }
+    return first < end;
+  }
+
+  // Lowest and highest set bits of reach, set in words first and end - 1.
+  std::pair<size_t, size_t> reach_hull(const std::vector<std::uint64_t>& reach,
+                                       size_t first, size_t end) {
+    return { first * 64 + __builtin_ctzll(reach[first]),
+             end * 64 - 1 - __builtin_clzll(reach[end - 1]) };
+  }
+
+}
+
+algorithms::detail::RouteSpans::RouteSpans(LineSource& source)
+  : _length(source.length()), _route(true) {
+  const size_t lines = source.lines(), words = (_length + 63) / 64;
+  if (_length < MIN_SPAN_LINE) {
+    return;
+  }
+  _lo.resize(lines);
+  _hi.resize(lines);
+  std::vector<std::uint64_t> reach(words, 0);
+
+  // backward, with line k at bit 64 * words - 1 - k: the goal is the
+  // lowest bit of the reversed last line, entered from below
+  const size_t pad = 64 * words - _length;
+  size_t first = pad / 64, end = first + 1;
+  reach[first] = std::uint64_t{1} << (pad % 64);
+  for (size_t a = lines; a-- > 0;) {
+    const std::uint64_t* line = source.line(a);
+    auto open = [&](size_t w) { return algorithms::detail::reverse_bits(line[words - 1 - w]); };
+    if (!advance(open, reach, first, end)) {
+      _route = false;
+      return;
+    }
+    const auto hull = reach_hull(reach, first, end);
+    _lo[a] = 64 * words - 1 - hull.second;
+    _hi[a] = 64 * words - 1 - hull.first;
+  }
+  if (_lo[0] != 0) {
+    // (0, 0) cannot reach the goal
+    _route = false;
+    return;
+  }
+
+  // forward, narrowing each span to the cells (0, 0) reaches, which is
+  // entered from above
+  std::fill(reach.begin(), reach.end(), 0);
+  reach[0] = 1;
+  first = 0;
+  end = 1;
+  for (size_t a = 0; a < lines; ++a) {
+    const std::uint64_t* line = source.line(a);
+    // never empty, since (0, 0) reaches the goal
+    advance([&](size_t w) { return line[w]; }, reach, first, end);
+    const auto hull = reach_hull(reach, first, end);
+    _lo[a] = std::max<size_t>(_lo[a], hull.first);
+    _hi[a] = std::min<size_t>(_hi[a], hull.second);
+  }
+}
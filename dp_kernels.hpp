@@ -0,0 +1,249 @@
+///////////////////////////////////////////////////////////////////////////////
+// dp_kernels.hpp
+//
+// Line kernels for the dynamic programming solvers. This header is an
+// implementation detail of the algorithms and is not part of the public
+// interface declared in poly_exp.hpp.
+//
+// A DP line is one row of the table (or one column, when a wide field is
+// swept column by column). Advancing the frontier by one line computes
+//
+//   line[k] = passable(k) ? above[k] + line[k - 1] : 0
+//
+// which is a prefix sum that restarts at every impassable cell. The generic
+// kernel does this one cell at a time; the counting policies that fit in a
+// 64-bit lane (wrap_u64, saturating_u64, mod_u64) get segmented-scan SIMD
+// kernels that are selected at run time for the host CPU.
+//
+// Every solver starts its frontier as the line above the first one, all 0
+// except a 1 at cell 0: a virtual start above (0, 0) with one route, so
+// the first line needs no special case.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "count_arith.hpp"
+#include "poly_exp.hpp"
+#include "timer.hpp"
+
+namespace algorithms {
+  namespace detail {
+
+    // Advance frontier[0..length) by one line, in place.
+    //
+    // Bit k of open (least significant bit of open[0] first) says whether
+    // cell k of the line is passable. On entry frontier[k] holds the count
+    // of the cell above cell k, on exit the count of cell k itself. left is
+    // the count of the cell just before cell 0 on this line (zero at the
+    // edge of the field).
+    template <typename Arith>
+    void update_line(const std::uint64_t* open,
+                     typename Arith::value_type* frontier,
+                     size_t length,
+                     const typename Arith::value_type& left,
+                     const Arith& arith) {
+      const typename Arith::value_type zero = arith.zero();
+      for (size_t base = 0; base < length; base += 64) {
+        const std::uint64_t word = open[base / 64];
+        const size_t end = (base + 64 < length) ? base + 64 : length;
+        if (word == 0) {
+          // a whole word of impassable cells
+          for (size_t k = base; k < end; ++k) {
+            frontier[k] = zero;
+          }
+          continue;
+        }
+        for (size_t k = base; k < end; ++k) {
+          if ((word >> (k - base)) & 1) {
+            arith.add_to(frontier[k], (k == 0) ? left : frontier[k - 1]);
+          } else {
+            frontier[k] = zero;
+          }
+        }
+      }
+    }
+
+    // SIMD kernels, chosen over the template above by overload resolution.
+
+    void update_line(const std::uint64_t* open, std::uint64_t* frontier,
+                     size_t length, std::uint64_t left, const wrap_u64& arith);
+
+    void update_line(const std::uint64_t* open, std::uint64_t* frontier,
+                     size_t length, std::uint64_t left,
+                     const saturating_u64& arith);
+
+    void update_line(const std::uint64_t* open, std::uint64_t* frontier,
+                     size_t length, std::uint64_t left, const mod_u64& arith);
+
+    // Pack length characters of one field row into passable bits, as
+    // PackedField does, one word per 64 characters. words must be zero on
+    // entry. Returns false if a character is neither '.' nor 'X'.
+    bool pack_row(const char* cells, size_t length, std::uint64_t* words);
+
+    // Return the name of the SIMD instruction set the 64-bit kernels use on
+    // this CPU: "avx2", "sse2", or "scalar".
+    const char* update_line_isa();
+
+    // Supplies the passable bits of each DP line of a PackedField, in order.
+    //
+    // Fields at least as tall as they are wide are swept row by row and the
+    // lines are the packed rows themselves. Wider fields are swept column by
+    // column; their lines are produced 64 at a time by transposing a strip
+    // of 64 columns in 64x64 bit blocks, which keeps the extra memory at
+    // O(rows) words.
+    class LineSource {
+    private:
+      const PackedField& _field;
+      bool _by_column;
+      size_t _strip_stride, _strip_index;
+      std::vector<std::uint64_t> _strip;
+
+    public:
+      explicit LineSource(const PackedField& field);
+
+      bool by_column() const { return _by_column; }
+
+      // Bytes of the transposed strip wide fields are read through.
+      size_t workspace_bytes() const {
+        return _strip.capacity() * sizeof(std::uint64_t);
+      }
+
+      // Number of lines, and number of cells in each line.
+      size_t lines() const;
+      size_t length() const;
+
+      // Passable bits of line a; the pointer stays valid until the next
+      // call. Lines may be requested in any order, but wide fields are
+      // fastest swept in either direction, which transposes each strip
+      // once.
+      const std::uint64_t* line(size_t a);
+    };
+
+    // The part of each DP line that routes from (0, 0) to the goal can use,
+    // found by two bitset passes over the lines before any counting.
+    //
+    // The backward pass marks the cells that can reach the goal, sweeping
+    // the lines from the last one with every line bit-reversed, and the
+    // forward pass marks the cells reachable from (0, 0). Within a line,
+    // reachability spreads through each run of passable cells from its
+    // seeds, the cells entered from the previous line, which one addition
+    // per word does: o + s carries through every run of o holding a seed
+    // of s, so
+    //
+    //   reach = (((o + s) ^ o ^ s) | s) & o
+    //
+    // with carries rippling from word to word. A pass only touches the
+    // words from a line's first reached cell to where its carries die out.
+    //
+    // Only the hull [lo, hi] of the cells marked in both passes is kept per
+    // line. Counting just those columns gives the exact count: a cell on a
+    // route only ever takes counts from cells on routes, which lie in the
+    // hulls, and cells in a hull but on no route never pass counts to one.
+    //
+    // Lines shorter than MIN_SPAN_LINE are single words that the DP sweeps
+    // about as fast as the passes would, so they are not searched: each
+    // spans its whole line, and route() is true.
+    class RouteSpans {
+    private:
+      size_t _length;
+      bool _route;
+      std::vector<std::uint32_t> _lo, _hi;
+
+    public:
+      static const size_t MIN_SPAN_LINE = 64;
+
+      // Spans of the lines of source, which must hold fewer than 2^32 cells
+      // each.
+      explicit RouteSpans(LineSource& source);
+
+      // Whether any route from (0, 0) to the goal may exist.
+      bool route() const { return _route; }
+
+      // Span of line a, when route() is true.
+      size_t lo(size_t a) const { return _lo.empty() ? 0 : _lo[a]; }
+      size_t hi(size_t a) const { return _lo.empty() ? _length - 1 : _hi[a]; }
+    };
+
+    // Count the routes of a validated field in the arithmetic of the given
+    // counting policy, keeping one frontier line of O(min(r, c)) counts.
+    //
+    // Lines are first narrowed to their RouteSpans, which also returns zero
+    // without counting when no route exists; the spans take 8 bytes per
+    // line of at least 64 cells, at most a quarter of the field's own
+    // bits. Each line then only counts the words its span
+    // touches, zeroing the frontier entries that enter the counted window
+    // from outside the previous line's.
+    //
+    // When SolveStats::ENABLED and stats is given, the DP counters are
+    // added to it, one popcount per counted line word; peak_workspace_bytes
+    // grows by the frontier and line workspace.
+    template <typename Arith>
+    typename Arith::value_type frontier_count(const PackedField& field,
+                                              const Arith& arith,
+                                              SolveStats* stats = nullptr) {
+      using value_type = typename Arith::value_type;
+      PhaseTimer allocation(Phase::allocation);
+      LineSource source(field);
+      const size_t length = source.length();
+      const value_type zero = arith.zero();
+      std::vector<value_type> frontier(length, zero);
+      frontier[0] = arith.one();
+      allocation.stop();
+      PhaseTimer compute(Phase::compute);
+      const RouteSpans spans(source);
+      if (!spans.route()) {
+        return zero;
+      }
+      // frontier[valid_lo, valid_hi] holds the previous line's counts
+      size_t valid_lo = 0, valid_hi = 0;
+      for (size_t a = 0; a < source.lines(); ++a) {
+        // count from the word holding lo through hi
+        const size_t lo = spans.lo(a) / 64 * 64, hi = spans.hi(a);
+        for (size_t k = lo; k < std::min(valid_lo, hi + 1); ++k) {
+          frontier[k] = zero;
+        }
+        for (size_t k = std::max(valid_hi + 1, lo); k <= hi; ++k) {
+          frontier[k] = zero;
+        }
+        const std::uint64_t* line = source.line(a) + lo / 64;
+        if (SolveStats::ENABLED && stats != nullptr) {
+          const size_t last = (hi - lo) / 64;
+          std::uint64_t open = __builtin_popcountll(
+            line[last] & (~std::uint64_t{0} >> (63 - (hi - lo) % 64)));
+          for (size_t w = 0; w < last; ++w) {
+            open += __builtin_popcountll(line[w]);
+          }
+          stats->cells_visited += hi + 1 - lo;
+          stats->obstacle_cells_skipped += hi + 1 - lo - open;
+        }
+        update_line(line, frontier.data() + lo, hi + 1 - lo, zero, arith);
+        valid_lo = lo;
+        valid_hi = hi;
+      }
+      if (SolveStats::ENABLED && stats != nullptr) {
+        stats->peak_workspace_bytes += frontier.capacity() * sizeof(value_type)
+                                     + source.workspace_bytes();
+      }
+      return frontier[length - 1];
+    }
+
+    // Transpose a 64x64 bit matrix in place, so that bit j of rows[i] ends
+    // up in bit i of rows[j].
+    void transpose64(std::uint64_t rows[64]);
+
+    // x with its bits in the opposite order: bit k moves to bit 63 - k.
+    inline std::uint64_t reverse_bits(std::uint64_t x) {
+      x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+      x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+      x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+      return __builtin_bswap64(x);
+    }
+
+  }
+}
@@ -0,0 +1,226 @@
+///////////////////////////////////////////////////////////////////////////////
+// exhaustive.cpp
+//
+// Definitions for the exhaustive search engines:
+//
+// soccer_exhaustive_dfs
+// soccer_exhaustive_mitm
+//
+// These are brute-force verifiers: they enumerate move sequences one by one
+// and never combine the counts of different cells the way the dynamic
+// programming solvers do.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "poly_exp.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+  // Longest route whose move sequence fits in a 64-bit mask, the limit of
+  // soccer_exhaustive, whose candidates the depth-first search enumerates.
+  const size_t MAX_MASK_MOVES = 63;
+
+  // Longest route the meet-in-the-middle search accepts; each half is at
+  // most 32 moves, and no count exceeds C(64, 32) < 2^63.
+  const size_t MAX_MITM_MOVES = 64;
+
+  // Prefixes handed out per thread when splitting the search tree, so that
+  // work stealing can even out subtrees of very different sizes.
+  const size_t PREFIXES_PER_THREAD = 16;
+
+  // A partial candidate: the first depth moves, leading to cell (row,
+  // column).
+  struct Prefix {
+    size_t depth, row, column;
+  };
+
+  // Depth-first enumeration of move sequences. A move that leaves the grid
+  // or lands on an 'X' invalidates every candidate sharing that prefix, so
+  // the whole subtree is skipped at once. Recursion depth is at most 63 and
+  // nothing is allocated.
+  class DepthFirstSearch {
+  private:
+    const algorithms::PackedField& _field;
+    const size_t _length;
+
+  public:
+    explicit DepthFirstSearch(const algorithms::PackedField& field)
+      : _field(field), _length(field.rows() + field.columns() - 2) {}
+
+    size_t length() const { return _length; }
+
+    // Return the children of prefix that are still valid, 'v' first.
+    size_t extend(const Prefix& prefix, Prefix children[2]) const {
+      size_t count = 0;
+      if (prefix.row + 1 < _field.rows() && _field.open(prefix.row + 1, prefix.column)) {
+        children[count++] = { prefix.depth + 1, prefix.row + 1, prefix.column };
+      }
+      if (prefix.column + 1 < _field.columns() && _field.open(prefix.row, prefix.column + 1)) {
+        children[count++] = { prefix.depth + 1, prefix.row, prefix.column + 1 };
+      }
+      return count;
+    }
+
+    // Number of valid candidates that start with prefix. A full-length
+    // candidate that stayed inside the grid ends at the bottom-right corner.
+    std::uint64_t count(const Prefix& prefix) const {
+      if (prefix.depth == _length) {
+        return 1;
+      }
+      Prefix children[2];
+      size_t valid = extend(prefix, children);
+      std::uint64_t total = 0;
+      for (size_t k = 0; k < valid; ++k) {
+        total += count(children[k]);
+      }
+      return total;
+    }
+  };
+
+  // Enumerates every half-path between a corner and the anti-diagonal
+  // i + j = diagonal, one move at a time, pruning a half-path as soon as it
+  // leaves the grid or lands on an 'X'. Every half-path found adds one to
+  // the tally of the diagonal cell it reaches, indexed by that cell's row.
+  class HalfPathSearch {
+  private:
+    const algorithms::PackedField& _field;
+    std::vector<std::uint64_t>& _tally;
+
+  public:
+    HalfPathSearch(const algorithms::PackedField& field,
+                   std::vector<std::uint64_t>& tally)
+      : _field(field), _tally(tally) {}
+
+    // Half-paths from (0, 0) going 'v' or '>'.
+    void forward(size_t row, size_t column, size_t moves) {
+      if (moves == 0) {
+        ++_tally[row];
+        return;
+      }
+      if (row + 1 < _field.rows() && _field.open(row + 1, column)) {
+        forward(row + 1, column, moves - 1);
+      }
+      if (column + 1 < _field.columns() && _field.open(row, column + 1)) {
+        forward(row, column + 1, moves - 1);
+      }
+    }
+
+    // Half-paths from the bottom-right corner, walked in reverse.
+    void backward(size_t row, size_t column, size_t moves) {
+      if (moves == 0) {
+        ++_tally[row];
+        return;
+      }
+      if (row > 0 && _field.open(row - 1, column)) {
+        backward(row - 1, column, moves - 1);
+      }
+      if (column > 0 && _field.open(row, column - 1)) {
+        backward(row, column - 1, moves - 1);
+      }
+    }
+  };
+
+}
+
+std::uint64_t
+algorithms::soccer_exhaustive_dfs(const std::vector<std::string>& field,
+                                  size_t threads) {
+  //If statement to check if field is empty
+  if (field.size() == 0 || field[0].size() == 0) {
+    throw std::invalid_argument("Invalid, empty");
+  }
+  if (field.size() + field[0].size() - 2 > MAX_MASK_MOVES) {
+    throw std::invalid_argument("Invalid, 64 bits");
+  }
+  return soccer_exhaustive_dfs(PackedField(field), threads);
+}
+
+std::uint64_t
+algorithms::soccer_exhaustive_dfs(const PackedField& field, size_t threads) {
+  DepthFirstSearch search(field);
+  if (search.length() > MAX_MASK_MOVES) {
+    throw std::invalid_argument("Invalid, 64 bits");
+  }
+  if (!field.open(0, 0)) {
+    return 0;
+  }
+  if (threads == 0) {
+    threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+  }
+  const Prefix root{0, 0, 0};
+  if (threads == 1) {
+    return search.count(root);
+  }
+
+  // Expand the top levels of the search tree breadth first until there are
+  // enough valid prefixes to share out, then search below each prefix as a
+  // separate task.
+  std::vector<Prefix> prefixes{root}, next;
+  while (prefixes.size() < threads * PREFIXES_PER_THREAD &&
+         !prefixes.empty() && prefixes[0].depth < search.length()) {
+    next.clear();
+    for (const auto& prefix : prefixes) {
+      Prefix children[2];
+      size_t valid = search.extend(prefix, children);
+      next.insert(next.end(), children, children + valid);
+    }
+    prefixes.swap(next);
+  }
+
+  std::vector<std::uint64_t> counts(prefixes.size(), 0);
+  TaskGroup group(ThreadPool::shared());
+  for (size_t k = 0; k < prefixes.size(); ++k) {
+    group.run([&, k] { counts[k] = search.count(prefixes[k]); });
+  }
+  group.wait();
+  std::uint64_t total = 0;
+  for (auto count : counts) {
+    total += count;
+  }
+  return total;
+}
+
+std::uint64_t
+algorithms::soccer_exhaustive_mitm(const std::vector<std::string>& field) {
+  //If statement to check if field is empty
+  if (field.size() == 0 || field[0].size() == 0) {
+    throw std::invalid_argument("Invalid, empty");
+  }
+  if (field.size() + field[0].size() - 2 > MAX_MITM_MOVES) {
+    throw std::invalid_argument("Invalid, 65 moves");
+  }
+  return soccer_exhaustive_mitm(PackedField(field));
+}
+
+std::uint64_t
+algorithms::soccer_exhaustive_mitm(const PackedField& field) {
+  const size_t rows = field.rows(), columns = field.columns();
+  const size_t length = rows + columns - 2;
+  if (length > MAX_MITM_MOVES) {
+    throw std::invalid_argument("Invalid, 65 moves");
+  }
+  if (!field.open(0, 0) || !field.open(rows - 1, columns - 1)) {
+    return 0;
+  }
+
+  // Every route crosses the middle anti-diagonal exactly once, so it splits
+  // into a first half ending at some diagonal cell and a second half
+  // starting there; conversely any two such halves meeting at the same cell
+  // form a route. The diagonal cells are known in advance, so the halves
+  // are joined through arrays indexed by row rather than a hash map.
+  const size_t diagonal = length / 2;
+  std::vector<std::uint64_t> first(rows, 0), second(rows, 0);
+  HalfPathSearch(field, first).forward(0, 0, diagonal);
+  HalfPathSearch(field, second).backward(rows - 1, columns - 1, length - diagonal);
+
+  std::uint64_t total = 0;
+  for (size_t i = 0; i < rows; ++i) {
+    total += first[i] * second[i];
+  }
+  return total;
+}
@@ -0,0 +1,368 @@
+///////////////////////////////////////////////////////////////////////////////
+// exhaustive_kernels.cpp
+//
+// Definitions for the bit-sliced candidate kernel.
+//
+// After d moves every candidate sits on the anti-diagonal i + j = d, so its
+// position is given by its row alone. The kernel keeps one bit plane per
+// row: bit t of at[k] is set when lane t is alive and in row k. One move
+// then updates a whole block with word operations,
+//
+//   at'[k] = ((at[k] & right) | (at[k - 1] & ~right)) & open(k, d - k)
+//
+// where bit t of right says whether move d - 1 of lane t is '>', and
+// open(k, d - k) is all ones when that cell is inside the field and
+// passable. Lanes that leave the grid or touch an 'X' simply drop out of
+// every plane. Only the planes between the lowest and highest row that
+// still hold a live lane are updated, and a block stops as soon as all of
+// its lanes have died, just like the candidate loop stops a candidate.
+//
+// When SolveStats are counted, each step also sorts the lanes it kills:
+// a lane whose next cell is (k, d - k) with d - k >= columns, or that
+// moves 'v' off the last row, leaves the grid; any other lane it kills
+// stopped on an 'X'. The counting versions of the steps are separate
+// instantiations, so the plain kernel is unchanged.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "exhaustive_kernels.hpp"
+#include "timer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+  // Longest route whose candidates the kernel enumerates, as in
+  // soccer_exhaustive.
+  const size_t MAX_CANDIDATE_MOVES = 31;
+
+  // Bit t of LANE_MOVES[j] is bit j of t, i.e. move j of lane t.
+  const std::uint64_t LANE_MOVES[6] = {
+    0xAAAAAAAAAAAAAAAAULL, 0xCCCCCCCCCCCCCCCCULL, 0xF0F0F0F0F0F0F0F0ULL,
+    0xFF00FF00FF00FF00ULL, 0xFFFF0000FFFF0000ULL, 0xFFFFFFFF00000000ULL,
+  };
+
+  // Obstacle bitmaps, one word per cell of every anti-diagonal: all ones
+  // when cell (k, d - k) is inside the field and passable, else zero.
+  class DiagonalMasks {
+  private:
+    size_t _rows;
+    std::vector<std::uint64_t> _open;
+
+  public:
+    DiagonalMasks(const algorithms::PackedField& field, size_t length)
+      : _rows(field.rows()), _open((length + 1) * field.rows(), 0) {
+      for (size_t d = 0; d <= length; ++d) {
+        for (size_t k = 0; k < _rows && k <= d; ++k) {
+          if (d - k < field.columns() && field.open(k, d - k)) {
+            _open[d * _rows + k] = ~std::uint64_t{0};
+          }
+        }
+      }
+    }
+
+    const std::uint64_t* diagonal(size_t d) const { return &_open[d * _rows]; }
+  };
+
+  // Rows that still hold a live lane lie in [lo, hi]; every plane outside
+  // that span is zero.
+  struct Span {
+    size_t lo, hi;
+    bool alive;
+  };
+
+  // Lanes killed, and moves tested, by some steps.
+  struct LaneStats {
+    std::uint64_t obstacle{0}, grid{0}, moves{0};
+  };
+
+  // Step to diagonal d, in a field of rows x columns, as seen by the
+  // counting steps: rows below first_inside are right of the grid.
+  struct Diagonal {
+    const std::uint64_t* open;
+    size_t rows, first_inside;
+
+    Diagonal(const DiagonalMasks& masks, size_t d, size_t rows, size_t columns)
+      : open(masks.diagonal(d)), rows(rows),
+        first_inside((d >= columns) ? d - columns + 1 : 0) {}
+  };
+
+  // Count the lanes of raw that next, the same lanes masked by row k's
+  // obstacle word, has lost.
+  __attribute__((always_inline)) inline
+  void count_step(std::uint64_t raw, std::uint64_t next, size_t k,
+                  const Diagonal& diagonal, LaneStats& stats) {
+    const std::uint64_t killed = __builtin_popcountll(raw & ~next);
+    if (k < diagonal.first_inside) {
+      stats.grid += killed;
+    } else {
+      stats.obstacle += killed;
+    }
+    stats.moves += killed + __builtin_popcountll(next);
+  }
+
+  // Advance every lane by one move to diagonal d, where bit t of right[w]
+  // is set when lane t of word w moves '>'.
+  template <size_t W, bool STATS>
+  __attribute__((always_inline)) inline
+  void step_lanes(std::uint64_t* at, const std::uint64_t (&right)[W],
+                  const Diagonal& diagonal, Span& span, LaneStats& stats) {
+    const std::uint64_t* open = diagonal.open;
+    const size_t rows = diagonal.rows;
+    const size_t top = std::min(span.hi + 1, rows - 1);
+    if (STATS && span.hi == rows - 1) {
+      // lanes moving 'v' from the last row leave the grid
+      for (size_t w = 0; w < W; ++w) {
+        const std::uint64_t gone = __builtin_popcountll(at[top * W + w] & ~right[w]);
+        stats.grid += gone;
+        stats.moves += gone;
+      }
+    }
+    size_t lo = top + 1, hi = 0;
+    bool alive = false;
+    // descending, so at[k - 1] still holds the previous move's plane
+    for (size_t k = top + 1; k-- > span.lo; ) {
+      std::uint64_t* plane = at + k * W;
+      const std::uint64_t* below = plane - W;
+      std::uint64_t any = 0;
+      for (size_t w = 0; w < W; ++w) {
+        const std::uint64_t raw = (plane[w] & right[w]) | (below[w] & ~right[w]);
+        const std::uint64_t next = raw & open[k];
+        if (STATS) {
+          count_step(raw, next, k, diagonal, stats);
+        }
+        plane[w] = next;
+        any |= next;
+      }
+      if (any != 0) {
+        hi = alive ? hi : k;
+        lo = k;
+        alive = true;
+      }
+    }
+    span = {lo, hi, alive};
+  }
+
+  // Advance every lane by the same move to diagonal d: the planes only
+  // shift down a row for 'v', and are masked by the obstacle bitmap.
+  template <size_t W, bool STATS>
+  __attribute__((always_inline)) inline
+  void step_uniform(std::uint64_t* at, bool right, const Diagonal& diagonal,
+                    Span& span, LaneStats& stats) {
+    const std::uint64_t* open = diagonal.open;
+    const size_t rows = diagonal.rows;
+    const size_t top = right ? span.hi : std::min(span.hi + 1, rows - 1);
+    const size_t from = right ? 0 : W;
+    if (STATS && !right && span.hi == rows - 1) {
+      for (size_t w = 0; w < W; ++w) {
+        const std::uint64_t gone = __builtin_popcountll(at[top * W + w]);
+        stats.grid += gone;
+        stats.moves += gone;
+      }
+    }
+    size_t lo = top + 1, hi = 0;
+    bool alive = false;
+    for (size_t k = top + 1; k-- > span.lo; ) {
+      std::uint64_t* plane = at + k * W;
+      const std::uint64_t* source = plane - from;
+      std::uint64_t any = 0;
+      for (size_t w = 0; w < W; ++w) {
+        const std::uint64_t next = source[w] & open[k];
+        if (STATS) {
+          count_step(source[w], next, k, diagonal, stats);
+        }
+        plane[w] = next;
+        any |= next;
+      }
+      if (any != 0) {
+        hi = alive ? hi : k;
+        lo = k;
+        alive = true;
+      }
+    }
+    span = {lo, hi, alive};
+  }
+
+  // Count the valid candidates, W words (64 * W lanes) per block. Inlined
+  // into each ISA's entry point so the word loops are vectorized for it.
+  //
+  // Blocks start at multiples of 64 * W, so the first log2(64 * W) moves
+  // of a lane depend only on its position in the block, and are the same
+  // for every block: they are stepped once, and each block starts from a
+  // copy of the result. Every later move is the same for all the lanes of
+  // a block. The shared moves are counted into stats once per block.
+  template <size_t W, bool STATS>
+  __attribute__((always_inline)) inline
+  std::uint64_t count_sliced(const algorithms::PackedField& field,
+                             const DiagonalMasks& masks, size_t length,
+                             LaneStats& stats) {
+    const size_t rows = field.rows(), columns = field.columns();
+    const size_t lane_bits = (W == 1) ? 6 : (W == 4) ? 8 : 9;
+    const std::uint64_t candidates = std::uint64_t{1} << length;
+    // Planes for rows -1..rows-1; the plane of row -1 stays zero.
+    std::vector<std::uint64_t> planes((rows + 1) * W, 0), start;
+    std::uint64_t* at = planes.data() + W;
+
+    // lanes past the last candidate start dead
+    for (size_t w = 0; w < W; ++w) {
+      const std::uint64_t first = 64 * w;
+      at[w] = (first >= candidates) ? 0
+            : (candidates - first >= 64) ? ~std::uint64_t{0}
+            : (std::uint64_t{1} << (candidates - first)) - 1;
+    }
+    Span span{0, 0, true};
+    LaneStats shared_stats;
+    const std::uint64_t blocks = (candidates + 64 * W - 1) / (64 * W);
+    const size_t shared = std::min(length, lane_bits);
+    for (size_t d = 1; d <= shared && span.alive; ++d) {
+      const size_t j = d - 1;
+      alignas(64) std::uint64_t right[W];
+      for (size_t w = 0; w < W; ++w) {
+        right[w] = (j < 6) ? LANE_MOVES[j]
+                 : ((((64 * w) >> j) & 1) ? ~std::uint64_t{0} : 0);
+      }
+      step_lanes<W, STATS>(at, right, Diagonal(masks, d, rows, columns), span,
+                           shared_stats);
+    }
+    if (STATS) {
+      stats.obstacle += shared_stats.obstacle * blocks;
+      stats.grid += shared_stats.grid * blocks;
+      stats.moves += shared_stats.moves * blocks;
+    }
+    if (!span.alive) {
+      return 0;
+    }
+    const Span start_span = span;
+    start.assign(at + start_span.lo * W, at + (start_span.hi + 1) * W);
+
+    std::uint64_t total = 0;
+    for (std::uint64_t base = 0; base < candidates; base += 64 * W) {
+      if (base != 0) {
+        std::copy(start.begin(), start.end(), at + start_span.lo * W);
+        span = start_span;
+      }
+      for (size_t d = shared + 1; d <= length && span.alive; ++d) {
+        step_uniform<W, STATS>(at, (base >> (d - 1)) & 1,
+                               Diagonal(masks, d, rows, columns), span, stats);
+      }
+      if (!span.alive) {
+        continue;
+      }
+      // A full-length candidate inside the grid ends at the bottom-right
+      // corner, the only cell of the last diagonal.
+      std::uint64_t* corner = at + (rows - 1) * W;
+      for (size_t w = 0; w < W; ++w) {
+        total += __builtin_popcountll(corner[w]);
+        corner[w] = 0;
+      }
+    }
+    return total;
+  }
+
+  template <bool STATS>
+  std::uint64_t count_64(const algorithms::PackedField& field,
+                         const DiagonalMasks& masks, size_t length,
+                         LaneStats& stats) {
+    return count_sliced<1, STATS>(field, masks, length, stats);
+  }
+
+#if defined(__x86_64__)
+
+  template <bool STATS>
+  __attribute__((target("avx2")))
+  std::uint64_t count_256(const algorithms::PackedField& field,
+                          const DiagonalMasks& masks, size_t length,
+                          LaneStats& stats) {
+    return count_sliced<4, STATS>(field, masks, length, stats);
+  }
+
+  template <bool STATS>
+  __attribute__((target("avx512f")))
+  std::uint64_t count_512(const algorithms::PackedField& field,
+                          const DiagonalMasks& masks, size_t length,
+                          LaneStats& stats) {
+    return count_sliced<8, STATS>(field, masks, length, stats);
+  }
+
+#endif
+
+  template <bool STATS>
+  std::uint64_t count_lanes(const algorithms::PackedField& field, size_t lanes,
+                            LaneStats& stats) {
+    const size_t length = field.rows() + field.columns() - 2;
+    PhaseTimer allocation(Phase::allocation);
+    const DiagonalMasks masks(field, length);
+    allocation.stop();
+    PhaseTimer compute(Phase::compute);
+#if defined(__x86_64__)
+    if (lanes == 512) {
+      return count_512<STATS>(field, masks, length, stats);
+    }
+    if (lanes == 256) {
+      return count_256<STATS>(field, masks, length, stats);
+    }
+#endif
+    return count_64<STATS>(field, masks, length, stats);
+  }
+
+  // Check the route length and lanes, resolving lanes 0 to the widest.
+  size_t checked_lanes(const algorithms::PackedField& field, size_t lanes) {
+    if (field.rows() + field.columns() - 2 > MAX_CANDIDATE_MOVES) {
+      throw std::invalid_argument("Invalid, 32 bits");
+    }
+    if (lanes == 0) {
+      lanes = algorithms::detail::candidate_lanes();
+    }
+    if ((lanes != 64 && lanes != 256 && lanes != 512) ||
+        lanes > algorithms::detail::candidate_lanes()) {
+      throw std::invalid_argument("Invalid, lanes");
+    }
+    return lanes;
+  }
+
+}
+
+size_t algorithms::detail::candidate_lanes() {
+#if defined(__x86_64__)
+  static const size_t lanes = __builtin_cpu_supports("avx512f") ? 512
+                            : __builtin_cpu_supports("avx2") ? 256 : 64;
+  return lanes;
+#else
+  return 64;
+#endif
+}
+
+std::uint64_t algorithms::detail::count_candidates(const PackedField& field,
+                                                    size_t lanes) {
+  lanes = checked_lanes(field, lanes);
+  if (!field.open(0, 0)) {
+    return 0;
+  }
+  LaneStats unused;
+  return count_lanes<false>(field, lanes, unused);
+}
+
+std::uint64_t algorithms::detail::count_candidates(const PackedField& field,
+                                                    size_t lanes,
+                                                    SolveStats& stats) {
+  lanes = checked_lanes(field, lanes);
+  if (!SolveStats::ENABLED) {
+    return count_candidates(field, lanes);
+  }
+  const std::uint64_t candidates =
+    std::uint64_t{1} << (field.rows() + field.columns() - 2);
+  stats.candidates_generated += candidates;
+  if (!field.open(0, 0)) {
+    stats.candidates_killed_by_obstacle += candidates;
+    return 0;
+  }
+  LaneStats lane_stats;
+  const std::uint64_t count = count_lanes<SolveStats::ENABLED>(field, lanes,
+                                                              lane_stats);
+  stats.candidates_killed_by_obstacle += lane_stats.obstacle;
+  stats.candidates_killed_leaving_grid += lane_stats.grid;
+  stats.prefix_moves += lane_stats.moves;
+  return count;
+}
@@ -0,0 +1,43 @@
+///////////////////////////////////////////////////////////////////////////////
+// exhaustive_kernels.hpp
+//
+// Bit-sliced candidate kernel for soccer_exhaustive. This header is an
+// implementation detail of the algorithms and is not part of the public
+// interface declared in poly_exp.hpp.
+//
+// soccer_exhaustive tests every candidate i in [0, 2^n), where bit j of i is
+// move j: 1 for '>' and 0 for 'v'. The kernel tests a block of 64, 256 or
+// 512 consecutive candidates at once, one candidate per bit lane of one,
+// four or eight 64-bit words, stepping all of them through the n moves
+// together.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "poly_exp.hpp"
+
+namespace algorithms {
+  namespace detail {
+
+    // Count the candidates of field that stay inside the grid, never touch
+    // an 'X', and end at the bottom-right corner, testing lanes candidates
+    // per block. lanes must be 64, or 256 or 512 when the host CPU supports
+    // AVX2 or AVX-512 respectively; 0 picks candidate_lanes().
+    //
+    // Throws std::invalid_argument if n > 31 or lanes is not supported.
+    std::uint64_t count_candidates(const PackedField& field, size_t lanes = 0);
+
+    // count_candidates, also adding the exhaustive search counters to
+    // stats when SolveStats::ENABLED.
+    std::uint64_t count_candidates(const PackedField& field, size_t lanes,
+                                   SolveStats& stats);
+
+    // Widest block the host CPU supports: 512, 256 or 64.
+    size_t candidate_lanes();
+
+  }
+}
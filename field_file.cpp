@@ -0,0 +1,625 @@
+///////////////////////////////////////////////////////////////////////////////
+// field_file.cpp
+//
+// Definitions for the solvers and converters of fields stored on disk:
+//
+// soccer_dyn_prog_file   text fields, one row per line
+// soccer_dyn_prog_sfld   binary .sfld fields
+//
+// Files are memory-mapped rather than read into strings. Each row is
+// decoded into a single reused row of bits or list of runs, then folded
+// into the DP frontier straight away, so apart from the frontier nothing
+// grows with the size of the field. The kernel is told the mapping is read
+// sequentially, and pages already consumed are dropped every RELEASE_BYTES
+// so that the resident part of the mapping stays bounded as well.
+//
+// An .sfld file is a 32-byte header followed by one record per row. All
+// integers are little-endian.
+//
+//   magic     4 bytes  "SFLD"
+//   version   u32      SFLD_VERSION
+//   rows      u64
+//   columns   u64
+//   checksum  u64      FNV-1a over the packed words of every row, see below
+//
+// A row record starts with a tag byte:
+//
+//   ROW_PACKED  (columns + 7) / 8 bytes of passable bits, least significant
+//               bit of the first byte first
+//   ROW_RUNS    LEB128 varints: the lengths of alternating runs of '.' and
+//               'X', starting with '.' (possibly an empty run), summing to
+//               columns
+//
+// and the writer picks whichever record is smaller, unless the runs would
+// decode to more than MAX_EXPANSION bytes of bits per byte of record. The
+// checksum feeds the row's (columns + 63) / 64 words of passable bits, as
+// PackedField stores them, one 64-bit word at a time through FNV-1a, so it
+// does not depend on which record type was chosen.
+//
+// Readers check the header against the file size before sizing anything
+// from it: every row takes at least two bytes, and the rows decode to at
+// most MAX_EXPANSION times the bytes of their records.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "poly_exp.hpp"
+#include "count_arith.hpp"
+#include "dp_kernels.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+  // How much of the file is consumed between releases of its pages.
+  const size_t RELEASE_BYTES = size_t{16} << 20;
+
+  // A read-only memory mapping of a whole file.
+  class MappedFile {
+  private:
+    int _fd;
+    const char* _data;
+    size_t _size;
+
+  public:
+    // Throws std::system_error if the file cannot be opened or mapped.
+    explicit MappedFile(const std::string& path)
+      : _fd(-1), _data(nullptr), _size(0) {
+      _fd = ::open(path.c_str(), O_RDONLY);
+      if (_fd < 0) {
+        throw std::system_error(errno, std::generic_category(), path);
+      }
+      struct stat status;
+      if (::fstat(_fd, &status) != 0) {
+        int error = errno;
+        ::close(_fd);
+        throw std::system_error(error, std::generic_category(), path);
+      }
+      _size = status.st_size;
+      if (_size == 0) {
+        return;
+      }
+      void* data = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+      if (data == MAP_FAILED) {
+        int error = errno;
+        ::close(_fd);
+        throw std::system_error(error, std::generic_category(), path);
+      }
+      _data = static_cast<const char*>(data);
+      ::madvise(data, _size, MADV_SEQUENTIAL);
+    }
+
+    ~MappedFile() {
+      if (_data != nullptr) {
+        ::munmap(const_cast<char*>(_data), _size);
+      }
+      ::close(_fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return _data; }
+    size_t size() const { return _size; }
+
+    // Drop the pages before offset end from memory. They are clean, so
+    // they are simply read back from the file if touched again.
+    void release(size_t end) const {
+      const size_t page = ::sysconf(_SC_PAGESIZE);
+      end = end / page * page;
+      if (end != 0) {
+        ::madvise(const_cast<char*>(_data), end, MADV_DONTNEED);
+      }
+    }
+  };
+
+  // Splits the mapped text into lines ending in '\n' or "\r\n"; the last
+  // newline is optional.
+  class LineReader {
+  private:
+    const char* _begin;
+    const char* _next;
+    const char* _end;
+    size_t _number;
+
+  public:
+    explicit LineReader(const MappedFile& file)
+      : _begin(file.data()), _next(file.data()),
+        _end(file.data() + file.size()), _number(0) {}
+
+    // 1-based number of the line last returned.
+    size_t number() const { return _number; }
+
+    // Bytes of the file consumed so far.
+    size_t offset() const { return _next - _begin; }
+
+    bool next(const char*& line, size_t& length) {
+      if (_next == _end) {
+        return false;
+      }
+      const void* newline = std::memchr(_next, '\n', _end - _next);
+      const char* stop = newline ? static_cast<const char*>(newline) : _end;
+      line = _next;
+      length = stop - _next;
+      if (length != 0 && line[length - 1] == '\r') {
+        --length;
+      }
+      _next = newline ? stop + 1 : _end;
+      ++_number;
+      return true;
+    }
+  };
+
+  std::invalid_argument invalid_at(const char* what, const char* unit,
+                                   size_t number) {
+    return std::invalid_argument(std::string(what) + " at " + unit + " " +
+                                 std::to_string(number));
+  }
+
+  // Validate and pack every row of a text field, calling visit(words,
+  // columns) with the passable bits of each row in turn.
+  template <typename Visit>
+  void for_each_text_row(const MappedFile& file, Visit visit) {
+    LineReader reader(file);
+    const char* line;
+    size_t columns;
+    if (!reader.next(line, columns) || columns == 0) {
+      throw std::invalid_argument("Invalid, empty");
+    }
+    std::vector<std::uint64_t> words((columns + 63) / 64);
+    size_t released = 0;
+    size_t length = columns;
+    do {
+      if (length != columns) {
+        throw invalid_at("Invalid, row less", "line", reader.number());
+      }
+      std::fill(words.begin(), words.end(), 0);
+      if (!algorithms::detail::pack_row(line, columns, words.data())) {
+        throw invalid_at("Invalid, character", "line", reader.number());
+      }
+      visit(words.data(), columns);
+      if (reader.offset() - released >= RELEASE_BYTES) {
+        released = reader.offset();
+        file.release(released);
+      }
+    } while (reader.next(line, length));
+  }
+
+  template <typename Arith>
+  typename Arith::value_type stream_count(const MappedFile& file,
+                                          const Arith& arith) {
+    std::vector<std::uint64_t> frontier;
+    for_each_text_row(file, [&](const std::uint64_t* words, size_t columns) {
+      if (frontier.empty()) {
+        frontier.assign(columns, arith.zero());
+        frontier[0] = arith.one();
+      }
+      algorithms::detail::update_line(words, frontier.data(), columns,
+                                      arith.zero(), arith);
+    });
+    return frontier.back();
+  }
+
+  const char SFLD_MAGIC[4] = {'S', 'F', 'L', 'D'};
+  const std::uint32_t SFLD_VERSION = 1;
+  const size_t SFLD_HEADER_BYTES = 32;
+
+  // Appended, with a number, to the path of an .sfld file while it is
+  // being written.
+  const char PART_SUFFIX[] = ".part.";
+
+  // Bytes of row records buffered between writes.
+  const size_t WRITE_BYTES = size_t{1} << 20;
+
+  // Most bytes of passable bits a row record decodes to per byte of it.
+  const size_t MAX_EXPANSION = 1024;
+
+  // Row record tags.
+  const unsigned char ROW_PACKED = 0, ROW_RUNS = 1;
+
+  const std::uint64_t FNV_OFFSET = 14695981039346656037ULL,
+                      FNV_PRIME = 1099511628211ULL;
+
+  std::uint64_t checksum_row(std::uint64_t hash, const std::uint64_t* words,
+                             size_t count) {
+    for (size_t w = 0; w < count; ++w) {
+      hash = (hash ^ words[w]) * FNV_PRIME;
+    }
+    return hash;
+  }
+
+  // First index in [from, end) whose bit is value, or end if there is none.
+  size_t find_bit(const std::uint64_t* words, size_t from, size_t end,
+                  bool value) {
+    while (from < end) {
+      std::uint64_t word = value ? words[from / 64] : ~words[from / 64];
+      word &= ~std::uint64_t{0} << (from % 64);
+      if (word != 0) {
+        return std::min(end, from / 64 * 64 + __builtin_ctzll(word));
+      }
+      from = (from / 64 + 1) * 64;
+    }
+    return end;
+  }
+
+  // Set bits [from, end) of words.
+  void set_bits(std::uint64_t* words, size_t from, size_t end) {
+    while (from < end) {
+      const size_t stop = std::min(end, (from / 64 + 1) * 64);
+      const size_t width = stop - from;
+      const std::uint64_t mask = (width == 64) ? ~std::uint64_t{0}
+                                 : ((std::uint64_t{1} << width) - 1);
+      words[from / 64] |= mask << (from % 64);
+      from = stop;
+    }
+  }
+
+  void put_u64(std::string& out, std::uint64_t value, size_t bytes = 8) {
+    for (size_t b = 0; b < bytes; ++b) {
+      out.push_back(static_cast<char>(value >> (8 * b)));
+    }
+  }
+
+  void put_varint(std::string& out, std::uint64_t value) {
+    while (value >= 0x80) {
+      out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+      value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+  }
+
+  // Writes an .sfld file one row at a time. The header is written last,
+  // once the number of rows and the checksum are known. The rows go to a
+  // new file next to path, named path, PART_SUFFIX and a number no other
+  // writer has taken, which finish renames to path and the destructor
+  // removes if finish was not reached, so a failed write never leaves a
+  // partial file at path, and writers to the same path never share one.
+  // Records are buffered and written WRITE_BYTES at a time.
+  class SfldWriter {
+  private:
+    std::string _path, _part;
+    int _fd;
+    size_t _columns, _rows;
+    std::uint64_t _checksum;
+    std::string _record, _buffer;
+    bool _finished;
+
+    // Write size bytes at data to the part file, at offset if it is not
+    // -1, else at its end.
+    void write_all(const char* data, size_t size, off_t offset = -1) {
+      while (size != 0) {
+        const ssize_t written = (offset < 0) ? ::write(_fd, data, size)
+                                             : ::pwrite(_fd, data, size, offset);
+        if (written < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          throw std::system_error(errno, std::generic_category(), _part);
+        }
+        data += written;
+        size -= written;
+        if (offset >= 0) {
+          offset += written;
+        }
+      }
+    }
+
+    void flush() {
+      write_all(_buffer.data(), _buffer.size());
+      _buffer.clear();
+    }
+
+  public:
+    SfldWriter(const std::string& path, size_t columns)
+      : _path(path), _fd(-1), _columns(columns), _rows(0),
+        _checksum(FNV_OFFSET), _finished(false) {
+      static std::atomic<unsigned> next_part(0);
+      const std::string prefix = path + PART_SUFFIX + std::to_string(::getpid()) + '.';
+      do {
+        _part = prefix + std::to_string(next_part++);
+        _fd = ::open(_part.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+      } while (_fd < 0 && errno == EEXIST);
+      if (_fd < 0) {
+        throw std::system_error(errno, std::generic_category(), _part);
+      }
+      _buffer.assign(SFLD_HEADER_BYTES, '\0');
+    }
+
+    SfldWriter(const SfldWriter&) = delete;
+    SfldWriter& operator=(const SfldWriter&) = delete;
+
+    ~SfldWriter() {
+      if (_fd >= 0) {
+        ::close(_fd);
+      }
+      if (!_finished) {
+        ::unlink(_part.c_str());
+      }
+    }
+
+    // Append the row with passable bits words.
+    void write_row(const std::uint64_t* words) {
+      const size_t packed = 1 + (_columns + 7) / 8;
+      _record.clear();
+      _record.push_back(ROW_RUNS);
+      bool open = true;
+      for (size_t k = 0; k < _columns && _record.size() < packed; open = !open) {
+        const size_t stop = find_bit(words, k, _columns, !open);
+        put_varint(_record, stop - k);
+        k = stop;
+      }
+      if (_record.size() >= packed || _record.size() * MAX_EXPANSION < packed - 1) {
+        _record.clear();
+        _record.push_back(ROW_PACKED);
+        for (size_t b = 0; b < (_columns + 7) / 8; ++b) {
+          _record.push_back(static_cast<char>(words[b / 8] >> (8 * (b % 8))));
+        }
+      }
+      _buffer += _record;
+      if (_buffer.size() >= WRITE_BYTES) {
+        flush();
+      }
+      _checksum = checksum_row(_checksum, words, (_columns + 63) / 64);
+      ++_rows;
+    }
+
+    void finish() {
+      flush();
+      std::string header(SFLD_MAGIC, sizeof(SFLD_MAGIC));
+      put_u64(header, SFLD_VERSION, 4);
+      put_u64(header, _rows);
+      put_u64(header, _columns);
+      put_u64(header, _checksum);
+      write_all(header.data(), header.size(), 0);
+      const int fd = _fd;
+      _fd = -1;
+      if (::close(fd) != 0) {
+        throw std::system_error(errno, std::generic_category(), _part);
+      }
+      if (::rename(_part.c_str(), _path.c_str()) != 0) {
+        throw std::system_error(errno, std::generic_category(), _path);
+      }
+      _finished = true;
+    }
+  };
+
+  // Reads the rows of a mapped .sfld file in order.
+  class SfldReader {
+  private:
+    const MappedFile& _file;
+    const unsigned char* _data;
+    size_t _offset, _rows, _columns, _row;
+    std::uint64_t _checksum, _expected;
+
+    std::uint64_t get_u64(size_t bytes = 8) {
+      std::uint64_t value = 0;
+      for (size_t b = 0; b < bytes; ++b) {
+        value |= std::uint64_t{_data[_offset++]} << (8 * b);
+      }
+      return value;
+    }
+
+    std::uint64_t get_varint() {
+      std::uint64_t value = 0;
+      for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (_offset == _file.size()) {
+          throw invalid_at("Invalid, truncated", "row", _row + 1);
+        }
+        const unsigned char byte = _data[_offset++];
+        value |= std::uint64_t{byte & 0x7Fu} << shift;
+        if ((byte & 0x80) == 0) {
+          return value;
+        }
+      }
+      throw invalid_at("Invalid, sfld row", "row", _row + 1);
+    }
+
+  public:
+    // Throws std::invalid_argument if the header is not a valid one.
+    explicit SfldReader(const MappedFile& file)
+      : _file(file), _data(reinterpret_cast<const unsigned char*>(file.data())),
+        _offset(0), _row(0), _checksum(FNV_OFFSET) {
+      if (file.size() < SFLD_HEADER_BYTES ||
+          !std::equal(SFLD_MAGIC, SFLD_MAGIC + 4, file.data())) {
+        throw std::invalid_argument("Invalid, not an sfld file");
+      }
+      _offset = 4;
+      if (get_u64(4) != SFLD_VERSION) {
+        throw std::invalid_argument("Invalid, sfld version");
+      }
+      _rows = get_u64();
+      _columns = get_u64();
+      _expected = get_u64();
+      if (_rows == 0 || _columns == 0) {
+        throw std::invalid_argument("Invalid, empty");
+      }
+      // each row is a tag byte and at least one byte of data, and decodes
+      // to (columns + 7) / 8 bytes of bits
+      const size_t records = file.size() - SFLD_HEADER_BYTES;
+      const size_t row_bytes = _columns / 8 + (_columns % 8 != 0);
+      size_t decoded;
+      if (_rows > records / 2 ||
+          __builtin_mul_overflow(_rows, row_bytes, &decoded) ||
+          decoded / MAX_EXPANSION > records) {
+        throw std::invalid_argument("Invalid, sfld size");
+      }
+    }
+
+    size_t rows() const { return _rows; }
+    size_t columns() const { return _columns; }
+    size_t offset() const { return _offset; }
+
+    // Decode the next row into words, (columns + 63) / 64 of them. If the
+    // row was stored as runs and runs is not null, also return its run
+    // lengths there, and return true.
+    bool read_row(std::uint64_t* words, std::vector<std::uint64_t>* runs) {
+      const size_t count = (_columns + 63) / 64;
+      if (_offset == _file.size()) {
+        throw invalid_at("Invalid, truncated", "row", _row + 1);
+      }
+      std::fill(words, words + count, 0);
+      const unsigned char tag = _data[_offset++];
+      bool as_runs = false;
+      if (tag == ROW_PACKED) {
+        const size_t bytes = (_columns + 7) / 8;
+        if (_file.size() - _offset < bytes) {
+          throw invalid_at("Invalid, truncated", "row", _row + 1);
+        }
+        for (size_t b = 0; b < bytes; ++b) {
+          words[b / 8] |= std::uint64_t{_data[_offset++]} << (8 * (b % 8));
+        }
+        // bits past the last column must be clear
+        if (_columns % 64 != 0 && (words[count - 1] >> (_columns % 64)) != 0) {
+          throw invalid_at("Invalid, sfld row", "row", _row + 1);
+        }
+      } else if (tag == ROW_RUNS) {
+        if (runs != nullptr) {
+          runs->clear();
+          as_runs = true;
+        }
+        bool open = true;
+        for (size_t k = 0; k < _columns; open = !open) {
+          const std::uint64_t length = get_varint();
+          if (length > _columns - k) {
+            throw invalid_at("Invalid, sfld row", "row", _row + 1);
+          }
+          if (open) {
+            set_bits(words, k, k + length);
+          }
+          if (as_runs) {
+            runs->push_back(length);
+          }
+          k += length;
+        }
+      } else {
+        throw invalid_at("Invalid, sfld row", "row", _row + 1);
+      }
+      _checksum = checksum_row(_checksum, words, count);
+      ++_row;
+      return as_runs;
+    }
+
+    // Throws std::invalid_argument unless every row has been read, nothing
+    // follows them, and the checksum matches.
+    void finish() const {
+      if (_offset != _file.size()) {
+        throw std::invalid_argument("Invalid, sfld size");
+      }
+      if (_checksum != _expected) {
+        throw std::invalid_argument("Invalid, checksum");
+      }
+    }
+  };
+
+  // Advance frontier by one row given as alternating runs of '.' and 'X',
+  // starting with '.'. The cell before a passable run is impassable or
+  // outside the field, so each passable run is an independent prefix sum,
+  // done by the line kernel with ones, a line of passable bits, at least
+  // as long as the row; each impassable run is a fill.
+  template <typename Arith>
+  void update_runs(const std::vector<std::uint64_t>& runs,
+                   const std::uint64_t* ones,
+                   typename Arith::value_type* frontier, const Arith& arith) {
+    const typename Arith::value_type zero = arith.zero();
+    size_t k = 0;
+    bool open = true;
+    for (std::uint64_t length : runs) {
+      if (length != 0) {
+        if (open) {
+          algorithms::detail::update_line(ones, frontier + k, length, zero, arith);
+        } else {
+          std::fill(frontier + k, frontier + k + length, zero);
+        }
+        k += length;
+      }
+      open = !open;
+    }
+  }
+
+  template <typename Arith>
+  typename Arith::value_type sfld_count(const MappedFile& file,
+                                        const Arith& arith) {
+    SfldReader reader(file);
+    const size_t columns = reader.columns();
+    std::vector<std::uint64_t> frontier(columns, arith.zero());
+    std::vector<std::uint64_t> words((columns + 63) / 64), runs;
+    const std::vector<std::uint64_t> ones(words.size(), ~std::uint64_t{0});
+    frontier[0] = arith.one();
+    size_t released = 0;
+    for (size_t i = 0; i < reader.rows(); ++i) {
+      if (reader.read_row(words.data(), &runs)) {
+        update_runs(runs, ones.data(), frontier.data(), arith);
+      } else {
+        algorithms::detail::update_line(words.data(), frontier.data(), columns,
+                                        arith.zero(), arith);
+      }
+      if (reader.offset() - released >= RELEASE_BYTES) {
+        released = reader.offset();
+        file.release(released);
+      }
+    }
+    reader.finish();
+    return frontier[columns - 1];
+  }
+
+}
+
+std::uint64_t algorithms::soccer_dyn_prog_file(const std::string& path,
+                                               std::uint64_t modulus) {
+  const MappedFile file(path);
+  return detail::count_with_modulus(modulus, [&](const auto& arith) {
+    return stream_count(file, arith);
+  });
+}
+
+std::uint64_t algorithms::soccer_dyn_prog_sfld(const std::string& path,
+                                               std::uint64_t modulus) {
+  const MappedFile file(path);
+  return detail::count_with_modulus(modulus, [&](const auto& arith) {
+    return sfld_count(file, arith);
+  });
+}
+
+void algorithms::save_sfld(const PackedField& field, const std::string& path) {
+  SfldWriter writer(path, field.columns());
+  for (size_t i = 0; i < field.rows(); ++i) {
+    writer.write_row(field.row(i));
+  }
+  writer.finish();
+}
+
+algorithms::PackedField algorithms::load_sfld(const std::string& path) {
+  const MappedFile file(path);
+  SfldReader reader(file);
+  PackedField field(reader.rows(), reader.columns());
+  for (size_t i = 0; i < field.rows(); ++i) {
+    reader.read_row(field.row(i), nullptr);
+  }
+  reader.finish();
+  return field;
+}
+
+void algorithms::convert_text_to_sfld(const std::string& text_path,
+                                      const std::string& sfld_path) {
+  const MappedFile file(text_path);
+  std::unique_ptr<SfldWriter> writer;
+  for_each_text_row(file, [&](const std::uint64_t* words, size_t columns) {
+    if (!writer) {
+      writer.reset(new SfldWriter(sfld_path, columns));
+    }
+    writer->write_row(words);
+  });
+  writer->finish();
+}
@@ -0,0 +1,48 @@
+///////////////////////////////////////////////////////////////////////////////
+// fixed_shape.cpp
+//
+// Definition of soccer_dyn_prog_shaped, the run time dispatcher to the
+// fixed shape solvers.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "fixed_shape.hpp"
+#include "poly_exp.hpp"
+
+namespace {
+
+  // Solve field with the specialization for R x C, which must be its shape.
+  template <size_t R, size_t C>
+  int solve_fixed(const std::vector<std::string>& field) {
+    algorithms::FixedField<R, C> cells;
+    for (size_t i = 0; i < R; ++i) {
+      if (field[i].size() != C) {
+        throw std::invalid_argument("Invalid, row less");
+      }
+      field[i].copy(cells[i].data(), C);
+    }
+    // counted modulo 2^64; the low 32 bits are the count modulo 2^32, as
+    // soccer_dyn_prog returns it
+    return static_cast<int>(static_cast<std::uint32_t>(
+      algorithms::soccer_dyn_prog_fixed<R, C, std::uint64_t>(cells)));
+  }
+
+  template <class... Shapes>
+  int dispatch(const std::vector<std::string>& field,
+               algorithms::FixedShapeList<Shapes...>) {
+    const size_t rows = field.size(), columns = field[0].size();
+    int result = 0;
+    const bool fixed = ((rows == Shapes::rows && columns == Shapes::columns &&
+                         (result = solve_fixed<Shapes::rows, Shapes::columns>(field),
+                          true)) || ...);
+    return fixed ? result : algorithms::soccer_dyn_prog(field);
+  }
+
+}
+
+int algorithms::soccer_dyn_prog_shaped(const std::vector<std::string>& field) {
+  if (field.empty() || field[0].empty()) {
+    throw std::invalid_argument("Invalid, empty");
+  }
+  return dispatch(field, DispatchedShapes());
+}
@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////////
+// fixed_shape.hpp
+//
+// soccer_dyn_prog specialized for play fields whose shape is known at
+// compile time.
+//
+// A FixedField<R, C> holds its cells in a std::array, and
+// soccer_dyn_prog_fixed<R, C, Count> runs the same frontier DP as
+// soccer_dyn_prog with R and C as constants, so the loops can be fully
+// unrolled and the frontier is a std::array on the stack. It is constexpr,
+// so a fixed field can also be solved at compile time:
+//
+//    constexpr auto field = algorithms::make_fixed_field<2, 3>({"...", ".X."});
+//    static_assert(algorithms::soccer_dyn_prog_fixed(field) == 1);
+//
+// soccer_dyn_prog_shaped routes the shapes listed in DispatchedShapes to
+// their specializations at run time and every other shape to
+// soccer_dyn_prog.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace algorithms {
+
+  template <size_t R, size_t C>
+  using FixedField = std::array<std::array<char, C>, R>;
+
+  // Copy R strings of C characters each into a FixedField.
+  //
+  // Throws std::invalid_argument if a row is not C characters long.
+  template <size_t R, size_t C>
+  constexpr FixedField<R, C> make_fixed_field(const char* const (&rows)[R]) {
+    FixedField<R, C> field{};
+    for (size_t i = 0; i < R; ++i) {
+      for (size_t j = 0; j <= C; ++j) {
+        if ((rows[i][j] == '\0') != (j == C)) {
+          throw std::invalid_argument("Invalid, row less");
+        }
+        if (j < C) {
+          field[i][j] = rows[i][j];
+        }
+      }
+    }
+    return field;
+  }
+
+  // Count the routes of field in Count, an unsigned integer type or any
+  // literal type that can be built from 0 and 1 and added; the count wraps
+  // around however Count's addition does.
+  //
+  // Throws std::invalid_argument if a cell is neither '.' nor 'X', which
+  // makes a constant evaluation ill-formed.
+  template <size_t R, size_t C, class Count = std::uint64_t>
+  constexpr Count soccer_dyn_prog_fixed(const FixedField<R, C>& field) {
+    static_assert(R > 0 && C > 0, "Invalid, empty");
+    std::array<Count, C> line{};
+    line[0] = Count(1);
+    for (size_t i = 0; i < R; ++i) {
+      Count left = Count(0);
+      for (size_t j = 0; j < C; ++j) {
+        if (field[i][j] == '.') {
+          line[j] = line[j] + left;
+          left = line[j];
+        } else if (field[i][j] == 'X') {
+          line[j] = left = Count(0);
+        } else {
+          throw std::invalid_argument("Invalid, character");
+        }
+      }
+    }
+    return line[C - 1];
+  }
+
+  // A field shape, rows x columns.
+  template <size_t R, size_t C>
+  struct FixedShape {
+    static const size_t rows = R, columns = C;
+  };
+
+  template <class... Shapes>
+  struct FixedShapeList {};
+
+  // The shapes soccer_dyn_prog_shaped solves with soccer_dyn_prog_fixed.
+  using DispatchedShapes = FixedShapeList<FixedShape<8, 9>, FixedShape<9, 8>,
+                                          FixedShape<16, 24>, FixedShape<24, 16>>;
+
+  // soccer_dyn_prog, solving the shapes in DispatchedShapes with their
+  // specializations. It validates and counts like soccer_dyn_prog, and
+  // returns the same result.
+  int soccer_dyn_prog_shaped(const std::vector<std::string>& field);
+
+}
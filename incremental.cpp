@@ -0,0 +1,127 @@
+///////////////////////////////////////////////////////////////////////////////
+// incremental.cpp
+//
+// Definitions for IncrementalSoccerSolver.
+//
+// Tile (p, q) covers rows [p * TILE_ROWS, (p + 1) * TILE_ROWS) and columns
+// [q * TILE_COLUMNS, (q + 1) * TILE_COLUMNS), clipped to the field. As in
+// the tiled parallel solver, a tile's counts depend only on the last row of
+// the tile above it and the last column of the tile to its left, so those
+// two boundaries are all that is cached. Tiles are recomputed in row-major
+// order, which finishes both inputs of a tile before the tile itself.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "poly_exp.hpp"
+#include "count_arith.hpp"
+#include "dp_kernels.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+algorithms::IncrementalSoccerSolver::IncrementalSoccerSolver(
+    const std::vector<std::string>& field, std::uint64_t modulus)
+  : IncrementalSoccerSolver(PackedField(field), modulus) {}
+
+algorithms::IncrementalSoccerSolver::IncrementalSoccerSolver(
+    PackedField field, std::uint64_t modulus)
+  : _field(std::move(field)), _modulus(modulus) {
+  if (_modulus != 0) {
+    detail::validate_modulus(_modulus);
+  }
+  _tile_rows_count = (_field.rows() + TILE_ROWS - 1) / TILE_ROWS;
+  _tile_columns_count = (_field.columns() + TILE_COLUMNS - 1) / TILE_COLUMNS;
+  _bottom.assign(_tile_rows_count * _field.columns(), 0);
+  _right.assign(_tile_columns_count * _field.rows(), 0);
+  // nothing is cached yet, so every tile starts dirty
+  _dirty.assign(_tile_rows_count * _tile_columns_count, 1);
+  _first_dirty = 0;
+}
+
+void algorithms::IncrementalSoccerSolver::set_cell(size_t i, size_t j,
+                                                   bool blocked) {
+  if (i >= _field.rows() || j >= _field.columns()) {
+    throw std::invalid_argument("Invalid, cell");
+  }
+  if (_field.open(i, j) != blocked) {
+    return;
+  }
+  _field.set_open(i, j, !blocked);
+  const size_t tile = (i / TILE_ROWS) * _tile_columns_count + j / TILE_COLUMNS;
+  _dirty[tile] = 1;
+  _first_dirty = std::min(_first_dirty, tile);
+}
+
+std::uint64_t algorithms::IncrementalSoccerSolver::count() {
+  const size_t columns = _field.columns();
+  const size_t goal = (_tile_rows_count - 1) * columns + columns - 1;
+  if (_modulus != 0) {
+    update(detail::mod_u64(_modulus));
+    return _bottom[goal];
+  }
+  update(detail::saturating_u64());
+  if (_bottom[goal] == detail::saturating_u64::SATURATED) {
+    throw std::overflow_error("Overflow, count does not fit in 64 bits");
+  }
+  return _bottom[goal];
+}
+
+template <typename Arith>
+void algorithms::IncrementalSoccerSolver::update(const Arith& arith) {
+  const size_t tiles = _dirty.size();
+  for (size_t tile = _first_dirty; tile < tiles; ++tile) {
+    if (_dirty[tile]) {
+      _dirty[tile] = 0;
+      solve_tile(tile / _tile_columns_count, tile % _tile_columns_count, arith);
+    }
+  }
+  _first_dirty = tiles;
+}
+
+template <typename Arith>
+void algorithms::IncrementalSoccerSolver::solve_tile(size_t p, size_t q,
+                                                     const Arith& arith) {
+  const size_t rows = _field.rows(), columns = _field.columns();
+  const size_t row_begin = p * TILE_ROWS;
+  const size_t row_end = std::min(row_begin + TILE_ROWS, rows);
+  const size_t column_begin = q * TILE_COLUMNS;
+  const size_t width = std::min(size_t{TILE_COLUMNS}, columns - column_begin);
+
+  // start from the last row of the tile above, or from the virtual start
+  // above (0, 0)
+  if (p == 0) {
+    _scratch.assign(width, arith.zero());
+    if (q == 0) {
+      _scratch[0] = arith.one();
+    }
+  } else {
+    const std::uint64_t* above = &_bottom[(p - 1) * columns + column_begin];
+    _scratch.assign(above, above + width);
+  }
+
+  bool right_changed = false;
+  std::uint64_t* right = &_right[q * rows];
+  const std::uint64_t* left = (q == 0) ? nullptr : &_right[(q - 1) * rows];
+  for (size_t i = row_begin; i < row_end; ++i) {
+    detail::update_line(_field.row(i) + column_begin / PackedField::WORD_BITS,
+                        _scratch.data(), width,
+                        (q == 0) ? arith.zero() : left[i], arith);
+    if (right[i] != _scratch[width - 1]) {
+      right[i] = _scratch[width - 1];
+      right_changed = true;
+    }
+  }
+
+  std::uint64_t* bottom = &_bottom[p * columns + column_begin];
+  const bool bottom_changed = !std::equal(bottom, bottom + width, _scratch.begin());
+  std::copy(_scratch.begin(), _scratch.end(), bottom);
+
+  // the neighbours only need recomputing if the boundary they read changed
+  if (bottom_changed && p + 1 < _tile_rows_count) {
+    _dirty[(p + 1) * _tile_columns_count + q] = 1;
+  }
+  if (right_changed && q + 1 < _tile_columns_count) {
+    _dirty[p * _tile_columns_count + q + 1] = 1;
+  }
+}
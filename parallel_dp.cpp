@@ -0,0 +1,176 @@
+///////////////////////////////////////////////////////////////////////////////
+// parallel_dp.cpp
+//
+// Definitions for soccer_dyn_prog_parallel, the tiled wavefront solver.
+//
+// The field is cut into tiles of TILE_ROWS rows by a multiple of 64 columns.
+// A tile only needs the counts of the row just above it and of the column
+// just to its left, so
+//
+//   top[j]   holds the bottom row of the last finished tile in column j's
+//            tile column (initially the virtual start above (0, 0)), and
+//   left[i]  holds the right column of the last finished tile in row i's
+//            tile row,
+//
+// and each tile overwrites exactly the boundary values its right and lower
+// neighbours will read. Tile (p, q) becomes ready once (p - 1, q) and
+// (p, q - 1) have finished, so tiles run along anti-diagonal wavefronts,
+// scheduled by dependency counters on a work-stealing ThreadPool. Every
+// cell is computed from the same two neighbours in the same arithmetic as
+// the serial frontier DP, so the results are identical.
+//
+// Every solve runs on the shared ThreadPool, with at most threads tiles in
+// flight: a tile that becomes ready while threads are busy waits in a
+// queue, and the task that finishes a tile goes on with the oldest one
+// waiting there before it gives up its slot.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "poly_exp.hpp"
+#include "count_arith.hpp"
+#include "dp_kernels.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+  const size_t TILE_ROWS = 256;
+
+  // Tile columns per thread, so that the wavefront stays wide enough to
+  // keep every thread busy.
+  const size_t TILE_COLUMNS_PER_THREAD = 4;
+
+  // Narrowest tile, in columns.
+  const size_t MIN_TILE_COLUMNS = 256;
+
+  template <typename Arith>
+  class TiledSolver {
+  private:
+    using value_type = typename Arith::value_type;
+
+    const algorithms::PackedField& _field;
+    const Arith& _arith;
+    size_t _tile_columns, _tile_rows_count, _tile_columns_count;
+    std::vector<value_type> _top, _left;
+    // number of unfinished tiles each tile still waits for
+    std::unique_ptr<std::atomic<unsigned>[]> _waiting;
+    // ready tiles without a slot, and the slots taken out of threads
+    std::mutex _lock;
+    std::deque<size_t> _queued;
+    size_t _running, _threads;
+
+  public:
+    TiledSolver(const algorithms::PackedField& field, const Arith& arith,
+                size_t threads)
+      : _field(field), _arith(arith), _running(0), _threads(threads) {
+      const size_t columns = field.columns();
+      size_t width = (columns + threads * TILE_COLUMNS_PER_THREAD - 1)
+                     / (threads * TILE_COLUMNS_PER_THREAD);
+      width = std::max(width, MIN_TILE_COLUMNS);
+      _tile_columns = (width + 63) / 64 * 64;
+      _tile_rows_count = (field.rows() + TILE_ROWS - 1) / TILE_ROWS;
+      _tile_columns_count = (columns + _tile_columns - 1) / _tile_columns;
+      _top.assign(columns, arith.zero());
+      _top[0] = arith.one();
+      _left.assign(field.rows(), arith.zero());
+      const size_t tiles = _tile_rows_count * _tile_columns_count;
+      _waiting.reset(new std::atomic<unsigned>[tiles]);
+      for (size_t p = 0; p < _tile_rows_count; ++p) {
+        for (size_t q = 0; q < _tile_columns_count; ++q) {
+          _waiting[p * _tile_columns_count + q] = (p > 0) + (q > 0);
+        }
+      }
+    }
+
+    value_type solve(algorithms::ThreadPool& pool) {
+      algorithms::TaskGroup group(pool);
+      schedule(group, 0);
+      group.wait();
+      return _top[_field.columns() - 1];
+    }
+
+  private:
+    void run_tile(algorithms::TaskGroup& group, size_t p, size_t q) {
+      const size_t row_begin = p * TILE_ROWS;
+      const size_t row_end = std::min(row_begin + TILE_ROWS, _field.rows());
+      const size_t column_begin = q * _tile_columns;
+      const size_t width = std::min(_tile_columns, _field.columns() - column_begin);
+      const value_type zero = _arith.zero();
+      value_type* top = &_top[column_begin];
+      for (size_t i = row_begin; i < row_end; ++i) {
+        const value_type& left = (q == 0) ? zero : _left[i];
+        algorithms::detail::update_line(_field.row(i) + column_begin / 64, top,
+                                        width, left, _arith);
+        _left[i] = top[width - 1];
+      }
+      // release the neighbours that were only waiting for this tile
+      if (p + 1 < _tile_rows_count) {
+        release(group, p + 1, q);
+      }
+      if (q + 1 < _tile_columns_count) {
+        release(group, p, q + 1);
+      }
+    }
+
+    void release(algorithms::TaskGroup& group, size_t p, size_t q) {
+      const size_t tile = p * _tile_columns_count + q;
+      if (_waiting[tile].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        schedule(group, tile);
+      }
+    }
+
+    // Run the ready tile in a new task if a slot is free, else queue it.
+    void schedule(algorithms::TaskGroup& group, size_t tile) {
+      {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (_running == _threads) {
+          _queued.push_back(tile);
+          return;
+        }
+        ++_running;
+      }
+      group.run([this, &group, tile] { run_slot(group, tile); });
+    }
+
+    // Run tile, then the queued tiles, until the queue is empty.
+    void run_slot(algorithms::TaskGroup& group, size_t tile) {
+      for (;;) {
+        run_tile(group, tile / _tile_columns_count, tile % _tile_columns_count);
+        std::lock_guard<std::mutex> guard(_lock);
+        if (_queued.empty()) {
+          --_running;
+          return;
+        }
+        tile = _queued.front();
+        _queued.pop_front();
+      }
+    }
+  };
+
+}
+
+std::uint64_t
+algorithms::soccer_dyn_prog_parallel(const std::vector<std::string>& field,
+                                     size_t threads, std::uint64_t modulus) {
+  return soccer_dyn_prog_parallel(PackedField(field), threads, modulus);
+}
+
+std::uint64_t
+algorithms::soccer_dyn_prog_parallel(const PackedField& field,
+                                     size_t threads, std::uint64_t modulus) {
+  if (threads == 0) {
+    threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+  }
+  return detail::count_with_modulus(modulus, [&](const auto& arith) {
+    if (threads == 1) {
+      return detail::frontier_count(field, arith);
+    }
+    TiledSolver<std::decay_t<decltype(arith)>> solver(field, arith, threads);
+    return solver.solve(ThreadPool::shared());
+  });
+}
@@ -0,0 +1,212 @@
+///////////////////////////////////////////////////////////////////////////////
+// path_sampler.cpp
+//
+// Definitions for PathSampler.
+//
+// Routes to the goal are counted from the bottom-right corner back to the
+// top-left one, cell (i, j) from (i + 1, j) and (i, j + 1). Exact counts
+// saturate at UINT64_MAX; if the start's count does, they are counted
+// again as log2 counts, adding two counts as
+//
+//   log2(2^a + 2^b) = max(a, b) + log2(1 + 2^-|a - b|),
+//
+// with -infinity for cells that reach no goal.
+//
+// Both walks are branch-free, so the random moves cost no mispredictions.
+// The log2 walk draws LOG_LANES routes side by side, whose table reads
+// overlap instead of each waiting for the one before it; the exact walk
+// keeps one route, whose rank updates already hide its reads.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "poly_exp.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+  // Routes drawn per task of a batch, and side by side by the exact and
+  // the log2 walks.
+  const size_t ROUTES_PER_TASK = 1024, EXACT_LANES = 1, LOG_LANES = 4;
+
+  // 2^63, the probability 1 of a down threshold.
+  const std::uint64_t ALWAYS = std::uint64_t{1} << 63;
+
+  const std::uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ULL;
+
+  std::uint64_t mix(std::uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+
+  // The splitmix64 generator.
+  class SplitMix {
+  private:
+    std::uint64_t _state;
+
+  public:
+    explicit SplitMix(std::uint64_t state = 0) : _state(state) {}
+
+    std::uint64_t operator()() {
+      _state += GOLDEN_GAMMA;
+      return mix(_state);
+    }
+  };
+
+  // Uniform below bound, by Lemire's multiply and reject.
+  std::uint64_t below(std::uint64_t bound, SplitMix& random) {
+    unsigned __int128 product = static_cast<unsigned __int128>(random()) * bound;
+    if (static_cast<std::uint64_t>(product) < bound) {
+      const std::uint64_t threshold = -bound % bound;
+      while (static_cast<std::uint64_t>(product) < threshold) {
+        product = static_cast<unsigned __int128>(random()) * bound;
+      }
+    }
+    return static_cast<std::uint64_t>(product >> 64);
+  }
+
+  // Draw routes first to first + L - 1 of the batch with the given seed
+  // into moves, one after the other, from the exact counts or the down
+  // thresholds in table.
+  template <size_t L, bool EXACT>
+  void walk(const std::vector<std::uint64_t>& table, size_t columns,
+            size_t length, std::uint64_t seed, size_t first, char* moves) {
+    SplitMix random[L];
+    std::uint64_t rank[L];
+    size_t cell[L];
+    for (size_t lane = 0; lane < L; ++lane) {
+      random[lane] = SplitMix(mix(seed + (first + lane) * GOLDEN_GAMMA));
+      cell[lane] = 0;
+      // the route of this rank, the routes going down first coming first
+      rank[lane] = EXACT ? below(table[0], random[lane]) : 0;
+    }
+    for (size_t move = 0; move < length; ++move) {
+      for (size_t lane = 0; lane < L; ++lane) {
+        bool go_down;
+        if (EXACT) {
+          const bool at_bottom = cell[lane] + columns >= table.size();
+          const std::uint64_t down = at_bottom ? 0 : table[cell[lane] + columns];
+          go_down = rank[lane] < down;
+          rank[lane] -= go_down ? 0 : down;
+        } else {
+          go_down = (random[lane]() >> 1) < table[cell[lane]];
+        }
+        moves[lane * length + move] = go_down ? 'v' : '>';
+        cell[lane] += go_down ? columns : 1;
+      }
+    }
+  }
+
+  // log2(2^a + 2^b).
+  double log2_add(double a, double b) {
+    if (a < b) {
+      std::swap(a, b);
+    }
+    if (b == -std::numeric_limits<double>::infinity()) {
+      return a;
+    }
+    return a + std::log2(1 + std::exp2(b - a));
+  }
+
+}
+
+algorithms::PathSampler::PathSampler(const std::vector<std::string>& field)
+  : PathSampler(PackedField(field)) {}
+
+algorithms::PathSampler::PathSampler(const PackedField& field)
+  : _rows(field.rows()), _columns(field.columns()), _exact(true),
+    _table(_rows * _columns, 0), _log2_count(0) {
+  auto at = [&](size_t i, size_t j) { return i * _columns + j; };
+
+  for (size_t i = _rows; i-- > 0;) {
+    for (size_t j = _columns; j-- > 0;) {
+      std::uint64_t& routes = _table[at(i, j)];
+      if (!field.open(i, j)) {
+        continue;
+      }
+      if (i + 1 == _rows && j + 1 == _columns) {
+        routes = 1;
+        continue;
+      }
+      const std::uint64_t down = (i + 1 < _rows) ? _table[at(i + 1, j)] : 0;
+      const std::uint64_t right = (j + 1 < _columns) ? _table[at(i, j + 1)] : 0;
+      if (__builtin_add_overflow(down, right, &routes)) {
+        routes = UINT64_MAX;
+      }
+    }
+  }
+  if (_table[0] == 0) {
+    throw std::invalid_argument("Invalid, no routes");
+  }
+  if (_table[0] != UINT64_MAX) {
+    _log2_count = std::log2(double(_table[0]));
+    return;
+  }
+
+  // too many routes for exact counts
+  _exact = false;
+  const double NONE = -std::numeric_limits<double>::infinity();
+  std::vector<double> log2_routes(_rows * _columns, NONE);
+  for (size_t i = _rows; i-- > 0;) {
+    for (size_t j = _columns; j-- > 0;) {
+      if (!field.open(i, j)) {
+        _table[at(i, j)] = 0;
+        continue;
+      }
+      if (i + 1 == _rows && j + 1 == _columns) {
+        log2_routes[at(i, j)] = 0;
+        continue;
+      }
+      const double down = (i + 1 < _rows) ? log2_routes[at(i + 1, j)] : NONE;
+      const double right = (j + 1 < _columns) ? log2_routes[at(i, j + 1)] : NONE;
+      const double routes = log2_add(down, right);
+      log2_routes[at(i, j)] = routes;
+      // a forced move is exact, so no draw can leave the routes
+      if (right == NONE) {
+        _table[at(i, j)] = ALWAYS;
+      } else if (down == NONE) {
+        _table[at(i, j)] = 0;
+      } else {
+        _table[at(i, j)] = std::min<std::uint64_t>(
+          ALWAYS - 1, std::uint64_t(std::ldexp(std::exp2(down - routes), 63)));
+      }
+    }
+  }
+  _log2_count = log2_routes[0];
+}
+
+double algorithms::PathSampler::log2_count() const {
+  return _log2_count;
+}
+
+std::vector<char> algorithms::PathSampler::sample_seeded(size_t n,
+                                                         std::uint64_t seed) const {
+  const size_t length = path_length();
+  std::vector<char> moves(n * length);
+  if (length == 0) {
+    return moves;
+  }
+  TaskGroup group(ThreadPool::shared());
+  for (size_t first = 0; first < n; first += ROUTES_PER_TASK) {
+    group.run([this, &moves, seed, first, n, length] {
+      const size_t end = std::min(n, first + ROUTES_PER_TASK);
+      auto lanes = _exact ? walk<EXACT_LANES, true> : walk<LOG_LANES, false>;
+      auto one = _exact ? walk<1, true> : walk<1, false>;
+      const size_t step = _exact ? EXACT_LANES : LOG_LANES;
+      size_t k = first;
+      for (; k + step <= end; k += step) {
+        lanes(_table, _columns, length, seed, k, &moves[k * length]);
+      }
+      for (; k < end; ++k) {
+        one(_table, _columns, length, seed, k, &moves[k * length]);
+      }
+    });
+  }
+  group.wait();
+  return moves;
+}
@@ -0,0 +1,281 @@
+///////////////////////////////////////////////////////////////////////////////
+// path_tables.cpp
+//
+// Definitions for PathCountTables.
+//
+// The forward table is the usual DP, keeping every line instead of only the
+// frontier. The backward table is the forward table of the field rotated by
+// 180 degrees, read back to front: cell (i, j) of the field is cell
+// (r - 1 - i, c - 1 - j) of the rotated field, which is index
+// r * c - 1 - (i * c + j) in row-major order. Both passes use the same line
+// kernels as soccer_dyn_prog and run concurrently.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "poly_exp.hpp"
+#include "count_arith.hpp"
+#include "dp_kernels.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+  // Row bands handed out per pool thread by critical_cells.
+  const size_t BANDS_PER_THREAD = 4;
+
+  // The field rotated by 180 degrees.
+  algorithms::PackedField rotate(const algorithms::PackedField& field) {
+    const size_t rows = field.rows(), columns = field.columns();
+    const size_t words = (columns + 63) / 64;
+    // Reversing all the words of a row reverses columns plus pad bits, and
+    // moves the clear padding bits to the bottom, so shift them back out.
+    const size_t pad = words * 64 - columns;
+    algorithms::PackedField rotated(rows, columns);
+    for (size_t i = 0; i < rows; ++i) {
+      const std::uint64_t* in = field.row(rows - 1 - i);
+      std::uint64_t* out = rotated.row(i);
+      for (size_t w = 0; w < words; ++w) {
+        out[words - 1 - w] = algorithms::detail::reverse_bits(in[w]);
+      }
+      if (pad != 0) {
+        for (size_t w = 0; w < words; ++w) {
+          out[w] = (out[w] >> pad) | ((w + 1 < words) ? out[w + 1] << (64 - pad) : 0);
+        }
+      }
+    }
+    return rotated;
+  }
+
+  // Fill table with the count of routes from (0, 0) to every cell.
+  template <typename Arith>
+  void fill_forward(const algorithms::PackedField& field, const Arith& arith,
+                    std::vector<std::uint64_t>& table) {
+    const size_t rows = field.rows(), columns = field.columns();
+    table.assign(rows * columns, arith.zero());
+    table[0] = arith.one();
+    for (size_t i = 0; i < rows; ++i) {
+      std::uint64_t* line = &table[i * columns];
+      if (i > 0) {
+        std::copy(line - columns, line, line);
+      }
+      algorithms::detail::update_line(field.row(i), line, columns,
+                                      arith.zero(), arith);
+    }
+  }
+
+  // Whether a should be reported before b.
+  bool more_critical(const algorithms::CriticalCell& a,
+                     const algorithms::CriticalCell& b) {
+    if (a.through != b.through) {
+      return a.through > b.through;
+    }
+    return (a.row != b.row) ? a.row < b.row : a.column < b.column;
+  }
+
+}
+
+algorithms::PathCountTables::PathCountTables(
+    const std::vector<std::string>& field, std::uint64_t modulus)
+  : PathCountTables(PackedField(field), modulus) {}
+
+algorithms::PathCountTables::PathCountTables(const PackedField& field,
+                                             std::uint64_t modulus)
+  : _rows(field.rows()), _columns(field.columns()), _modulus(modulus) {
+  _count = detail::count_with_modulus(modulus, [&](const auto& arith) {
+    TaskGroup group(ThreadPool::shared());
+    group.run([&] {
+      fill_forward(rotate(field), arith, _backward);
+      std::reverse(_backward.begin(), _backward.end());
+    });
+    fill_forward(field, arith, _forward);
+    group.wait();
+    return _forward.back();
+  });
+}
+
+void algorithms::PathCountTables::check_cell(size_t i, size_t j) const {
+  if (i >= _rows || j >= _columns) {
+    throw std::invalid_argument("Invalid, cell");
+  }
+}
+
+void algorithms::PathCountTables::check_exact(const char* message) const {
+  if (_modulus != 0) {
+    throw std::invalid_argument(message);
+  }
+}
+
+std::uint64_t algorithms::PathCountTables::through(size_t i, size_t j) const {
+  check_cell(i, j);
+  const std::uint64_t to = _forward[i * _columns + j];
+  const std::uint64_t from = _backward[i * _columns + j];
+  if (_modulus != 0) {
+    return static_cast<std::uint64_t>(static_cast<unsigned __int128>(to) * from
+                                      % _modulus);
+  }
+  // A cell on some route has both counts at most the total, which fits; a
+  // cell on no route may have saturated one of them, but the other is 0.
+  return (to == 0 || from == 0) ? 0 : to * from;
+}
+
+std::uint64_t
+algorithms::PathCountTables::count_if_blocked(size_t i, size_t j) const {
+  const std::uint64_t removed = through(i, j);
+  if (_modulus != 0) {
+    return (_count + _modulus - removed) % _modulus;
+  }
+  return _count - removed;
+}
+
+std::vector<algorithms::CriticalCell>
+algorithms::PathCountTables::critical_cells(size_t k) const {
+  check_exact("Invalid, critical cells need exact counts");
+  if (k == 0) {
+    return {};
+  }
+
+  // Each band keeps its own k best cells in a heap with the least critical
+  // on top; the bands are merged at the end.
+  ThreadPool& pool = ThreadPool::shared();
+  const size_t band_count = std::min(_rows, (pool.size() + 1) * BANDS_PER_THREAD);
+  const size_t band_rows = (_rows + band_count - 1) / band_count;
+  std::vector<std::vector<CriticalCell>> bands((_rows + band_rows - 1) / band_rows);
+  TaskGroup group(pool);
+  for (size_t b = 0; b < bands.size(); ++b) {
+    group.run([this, &bands, b, band_rows, k] {
+      auto& heap = bands[b];
+      const size_t end = std::min(_rows, (b + 1) * band_rows);
+      for (size_t i = b * band_rows; i < end; ++i) {
+        for (size_t j = 0; j < _columns; ++j) {
+          CriticalCell cell{i, j, through(i, j)};
+          if (cell.through == 0) {
+            continue;
+          }
+          if (heap.size() < k) {
+            heap.push_back(cell);
+            std::push_heap(heap.begin(), heap.end(), more_critical);
+          } else if (more_critical(cell, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), more_critical);
+            heap.back() = cell;
+            std::push_heap(heap.begin(), heap.end(), more_critical);
+          }
+        }
+      }
+    });
+  }
+  group.wait();
+
+  std::vector<CriticalCell> cells;
+  for (const auto& band : bands) {
+    cells.insert(cells.end(), band.begin(), band.end());
+  }
+  const size_t reported = std::min(k, cells.size());
+  std::partial_sort(cells.begin(), cells.begin() + reported, cells.end(),
+                    more_critical);
+  cells.resize(reported);
+  return cells;
+}
+
+// A cell on a route has at most count() routes from it, so the counts read
+// below are exact even where the saturating table clamped cells that no
+// route reaches.
+
+std::string algorithms::PathCountTables::unrank(std::uint64_t k) const {
+  check_exact("Invalid, ranks need exact counts");
+  if (k >= _count) {
+    throw std::invalid_argument("Invalid, rank");
+  }
+  std::string path;
+  path.reserve(_rows + _columns - 2);
+  size_t i = 0, j = 0;
+  while (i + 1 < _rows || j + 1 < _columns) {
+    // the routes going down first come first
+    const std::uint64_t down = routes_from(i + 1, j);
+    if (k < down) {
+      path.push_back('v');
+      ++i;
+    } else {
+      k -= down;
+      path.push_back('>');
+      ++j;
+    }
+  }
+  return path;
+}
+
+std::uint64_t algorithms::PathCountTables::rank(const std::string& path) const {
+  check_exact("Invalid, ranks need exact counts");
+  if (_count == 0 || path.size() != _rows + _columns - 2) {
+    throw std::invalid_argument("Invalid, path");
+  }
+  std::uint64_t k = 0;
+  size_t i = 0, j = 0;
+  for (char move : path) {
+    if (move == 'v') {
+      ++i;
+    } else if (move == '>') {
+      k += routes_from(i + 1, j);
+      ++j;
+    } else {
+      throw std::invalid_argument("Invalid, path");
+    }
+    if (routes_from(i, j) == 0) {
+      // off the field, or on a cell no route from (0, 0) leaves
+      throw std::invalid_argument("Invalid, path");
+    }
+  }
+  return k;
+}
+
+algorithms::PathCountTables::PathIterator
+algorithms::PathCountTables::paths_begin(std::uint64_t k) const {
+  check_exact("Invalid, ranks need exact counts");
+  PathIterator it;
+  if (k < _count) {
+    it._tables = this;
+    it._path = unrank(k);
+    it._done = false;
+  }
+  return it;
+}
+
+algorithms::PathCountTables::PathIterator
+algorithms::PathCountTables::paths_end() const {
+  check_exact("Invalid, ranks need exact counts");
+  return PathIterator();
+}
+
+algorithms::PathCountTables::PathIterator&
+algorithms::PathCountTables::PathIterator::operator++() {
+  const PathCountTables& tables = *_tables;
+  // back up from the goal to the last 'v' that can become a '>'
+  size_t i = tables._rows - 1, j = tables._columns - 1;
+  for (;;) {
+    if (_path.empty()) {
+      _done = true;
+      return *this;
+    }
+    const char move = _path.back();
+    _path.pop_back();
+    if (move == '>') {
+      --j;
+    } else if (tables.routes_from(--i, j + 1) != 0) {
+      break;
+    }
+  }
+  // then take the '>', and go down as early as possible after it
+  _path.push_back('>');
+  ++j;
+  while (i + 1 < tables._rows || j + 1 < tables._columns) {
+    if (tables.routes_from(i + 1, j) != 0) {
+      _path.push_back('v');
+      ++i;
+    } else {
+      _path.push_back('>');
+      ++j;
+    }
+  }
+  return *this;
+}
@@ -6,156 +6,340 @@
 // soccer_exhaustive
 // soccer_dyn_prog
 //
+// and for PackedField.
+//
 ///////////////////////////////////////////////////////////////////////////////
 
 
 #include "poly_exp.hpp"
+#include "count_arith.hpp"
+#include "dp_kernels.hpp"
+#include "exhaustive_kernels.hpp"
+#include "timer.hpp"
+#include <cstring>
 #include <iostream>
-#include <math.h>
+#include <numeric>
+#include <stdexcept>
 #include <vector>
 
-int algorithms::soccer_exhaustive(const std::vector<std::string> field) {
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+  //Each pack_row variant turns the characters of one row into passable bits,
+  //one output word per 64 characters, and returns false as soon as it sees
+  //a character other than '.' or 'X'
+
+#if defined(__x86_64__)
+
+  //Packs the 64 characters at block into word, and returns false if one of
+  //them is neither '.' nor 'X'
+  bool pack_block_sse2(const char* block, std::uint64_t& word) {
+    const __m128i dot = _mm_set1_epi8('.'), x = _mm_set1_epi8('X');
+    std::uint64_t bits = 0;
+    unsigned valid = 0xFFFF;
+    for(size_t k = 0; k < 4; k++){
+      __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * k));
+      __m128i is_dot = _mm_cmpeq_epi8(chunk, dot);
+      __m128i is_x = _mm_cmpeq_epi8(chunk, x);
+      valid &= static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(is_dot, is_x)));
+      bits |= static_cast<std::uint64_t>(_mm_movemask_epi8(is_dot)) << (16 * k);
+    }
+    word = bits;
+    return valid == 0xFFFF;
+  }
+
+  __attribute__((target("avx2")))
+  bool pack_block_avx2(const char* block, std::uint64_t& word) {
+    const __m256i dot = _mm256_set1_epi8('.'), x = _mm256_set1_epi8('X');
+    __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    __m256i high = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+    __m256i low_dot = _mm256_cmpeq_epi8(low, dot);
+    __m256i high_dot = _mm256_cmpeq_epi8(high, dot);
+    __m256i valid = _mm256_and_si256(_mm256_or_si256(low_dot, _mm256_cmpeq_epi8(low, x)),
+                                     _mm256_or_si256(high_dot, _mm256_cmpeq_epi8(high, x)));
+    word = static_cast<std::uint32_t>(_mm256_movemask_epi8(low_dot)) |
+           static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(high_dot))) << 32;
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(valid)) == 0xFFFFFFFFu;
+  }
+
+  //Packs a row 64 characters at a time, the last partial word padded with
+  //'X', which packs to the clear padding bits, instead of one character at
+  //a time
+  template <bool (*pack_block)(const char*, std::uint64_t&)>
+  bool pack_row_blocks(const char* cells, size_t length, std::uint64_t* words) {
+    size_t j = 0;
+    for(; j + 64 <= length; j += 64){
+      if(!pack_block(cells + j, words[j / 64])){
+        return false;
+      }
+    }
+    if(j < length){
+      char padded[64];
+      std::memset(padded, 'X', sizeof(padded));
+      std::memcpy(padded, cells + j, length - j);
+      return pack_block(padded, words[j / 64]);
+    }
+    return true;
+  }
+
+  //SSE2 is part of the x86-64 baseline, so this needs no dispatch
+  bool pack_row_sse2(const char* cells, size_t length, std::uint64_t* words) {
+    return pack_row_blocks<pack_block_sse2>(cells, length, words);
+  }
+
+  __attribute__((target("avx2")))
+  bool pack_row_avx2(const char* cells, size_t length, std::uint64_t* words) {
+    return pack_row_blocks<pack_block_avx2>(cells, length, words);
+  }
+
+#else
+
+  bool pack_row_scalar(const char* cells, size_t length, std::uint64_t* words) {
+    for(size_t j = 0; j < length; j++){
+      if(cells[j] == '.'){
+        words[j / 64] |= std::uint64_t{1} << (j % 64);
+      }
+      else if(cells[j] != 'X'){
+        return false;
+      }
+    }
+    return true;
+  }
+
+#endif
+
+  using pack_row_function = bool (*)(const char*, size_t, std::uint64_t*);
+
+  //Picks the widest packing routine this CPU supports
+  pack_row_function select_pack_row() {
+#if defined(__x86_64__)
+    if(__builtin_cpu_supports("avx2")){
+      return pack_row_avx2;
+    }
+    return pack_row_sse2;
+#else
+    return pack_row_scalar;
+#endif
+  }
+
+  //Number of moves in every route through a field
+  size_t route_length(const algorithms::PackedField& field) {
+    return field.rows() + field.columns() - 2;
+  }
 
+}
+
+algorithms::PackedField::PackedField(size_t rows, size_t columns)
+  : _rows(rows), _columns(columns) {
     //If statement to check if field is empty
-    if(field.size() == 0 || field[0].size() == 0){
+    if(rows == 0 || columns == 0){
       throw std::invalid_argument("Invalid, empty");
     }
-    //If statement to check if field is 1x1 and contains either . or X
-    if(field.size() == 1 && field[0].size() == 1){
-      if(field[0][0] == '.'){
-        return 1;
-      }
-      else if(field[0][0] == 'X'){
-        return 0;
+    size_t words = columns / WORD_BITS + (columns % WORD_BITS != 0);
+    _stride = (words + WORD_ALIGN - 1) / WORD_ALIGN * WORD_ALIGN;
+    size_t total;
+    //If statement to check the words of every row can be counted
+    if(_stride < words || __builtin_mul_overflow(_rows, _stride, &total)){
+      throw std::invalid_argument("Invalid, too large");
+    }
+    PhaseTimer phase(Phase::allocation);
+    _words.assign(total, 0);
+}
+
+bool algorithms::detail::pack_row(const char* cells, size_t length,
+                                  std::uint64_t* words) {
+    static const pack_row_function selected = select_pack_row();
+    return selected(cells, length, words);
+}
+
+algorithms::PackedField::PackedField(const std::vector<std::string>& field)
+  : PackedField(FieldView(field)) {}
+
+algorithms::PackedField::PackedField(FieldView field)
+  : PackedField(field.rows(), field.columns()) {
+    PhaseTimer phase(Phase::validation);
+    //For loop to check every row's shape and characters while packing it
+    for(size_t i = 0; i < _rows; i++){
+      if(field.row_size(i) != _columns){
+        throw std::invalid_argument("Invalid, row less");
       }
-      else{
+      if(!detail::pack_row(field.row(i), _columns, row(i))){
         throw std::invalid_argument("Invalid, character");
       }
     }
-    int maxrow = field.size();
-    int maxcolumn = field[0].size();
-    int field_length = maxrow + maxcolumn - 2;
+}
+
+int algorithms::soccer_exhaustive(const std::vector<std::string>& field) {
+    return soccer_exhaustive(FieldView(field));
+}
+
+int algorithms::soccer_exhaustive(FieldView field) {
+    SolveStats unused;
+    return soccer_exhaustive(field, unused);
+}
+
+int algorithms::soccer_exhaustive(FieldView field, SolveStats& stats) {
+
+    //If statement to check if field is empty
+    if(field.rows() == 0 || field.columns() == 0){
+      throw std::invalid_argument("Invalid, empty");
+    }
+    //If statement to check if n is greater than 31, before packing a field
+    //that could never be searched anyway
+    if(field.rows() + field.columns() - 2 > 31){
+      throw std::invalid_argument("Invalid, 32 bits");
+    }
+    return soccer_exhaustive(PackedField(field), stats);
+}
+
+int algorithms::soccer_exhaustive(const PackedField& field) {
+    SolveStats unused;
+    return soccer_exhaustive(field, unused);
+}
+
+int algorithms::soccer_exhaustive(const PackedField& field, SolveStats& stats) {
+    stats = SolveStats();
+
+    int field_length = route_length(field);
     //If statement to check if n is greater than 31
     if(field_length > 31){
       throw std::invalid_argument("Invalid, 32 bits");
     }
-    //For loop to check if field contains valid characters and is a valid field
-    for(int i = 0; i < maxrow; i++){
-      for(int j = 0; j < maxcolumn; j++){
-        if(field[i][j] != 'X' && field[i][j] != '.'){
-          throw std::invalid_argument("Invalid, character");
-        }
-      }
-      if(field[i].size() != maxcolumn){
-        throw std::invalid_argument("Invalid, row less");
-      }
-    }
-    int counter = 0;
-    bool basecase = true;
-    int row = 0;
-    int column = 0;
-    int b = 0;
-    //For loop to run through every possible candidate
-    for(int i = 0; i < pow(2,field_length); i++){
-      std::vector<char> candidate;
-      basecase = true;
-      row = 0;
-      column = 0;
-      for(int j = 0; j < field_length; j++){
-        b = (i >> j) & 1;
-        //If statement to overload bit and push right or down into candidate vector
-        if(b == 1){
-          candidate.push_back('>');
-        }
-        else{
-          candidate.push_back('v');
-        }
-        //If statement to count movements of candidates depending on direction
-        if(candidate[j] == '>'){
-          column++;
-        }
-        else if(candidate[j] == 'v'){
-          row++;
-        }
-        //If statement to check and stop loop if candidate is inside the grid
-        //and has never touched an x cell
-        if(row >= maxrow || column >= maxcolumn || field[row][column] == 'X'){
-          basecase = false;
-          break;
-        }
-      }
-      //If statement to check and count if candidate ends at (r-1)(c-1)
-      //and never touched an x cell and remained in the grid
-      if(basecase == true && row == maxrow - 1 && column == maxcolumn - 1){
-        counter++;
-      }
-    }
+    //Tests the candidates in blocks of 64 or more, one per bit lane, and
+    //returns 0 straight away if the starting cell is impassable
+    int counter = static_cast<int>(detail::count_candidates(field, 0, stats));
     //returns number of routes possible
     return counter;
 }
 
-int algorithms::soccer_dyn_prog(const std::vector<std::string> field) {
+int algorithms::soccer_dyn_prog(const std::vector<std::string>& field) {
+    return soccer_dyn_prog(FieldView(field));
+}
 
-    //If statement to check if field is empty
-    if(field.size() == 0 || field[0].size() == 0){
-      throw std::invalid_argument("Invalid, empty");
+int algorithms::soccer_dyn_prog(FieldView field) {
+    return soccer_dyn_prog(PackedField(field));
+}
+
+int algorithms::soccer_dyn_prog(FieldView field, SolveStats& stats) {
+    return soccer_dyn_prog(PackedField(field), stats);
+}
+
+int algorithms::soccer_dyn_prog(const PackedField& field) {
+    //Counting modulo 2^64 keeps overflow well defined and lets the SIMD
+    //kernels run; the low 32 bits are the count modulo 2^32
+    return static_cast<int>(static_cast<std::uint32_t>(detail::frontier_count(field, detail::wrap_u64())));
+}
+
+int algorithms::soccer_dyn_prog(const PackedField& field, SolveStats& stats) {
+    stats = SolveStats();
+    //The field was packed for this call, or by the caller for it
+    if (SolveStats::ENABLED) {
+      stats.peak_workspace_bytes = field.rows() * field.stride() * sizeof(std::uint64_t);
+    }
+    return static_cast<int>(static_cast<std::uint32_t>(detail::frontier_count(field, detail::wrap_u64(), &stats)));
+}
+
+std::uint64_t algorithms::soccer_dyn_prog_u64(const std::vector<std::string>& field) {
+    PackedField packed(field);
+    auto count = detail::frontier_count(packed, detail::saturating_u64());
+    if(count == detail::saturating_u64::SATURATED){
+      throw std::overflow_error("Overflow, count does not fit in 64 bits");
+    }
+    return count;
+}
+
+unsigned __int128 algorithms::soccer_dyn_prog_u128(const std::vector<std::string>& field) {
+    PackedField packed(field);
+    auto count = detail::frontier_count(packed, detail::saturating_u128());
+    if(count == detail::saturating_u128::SATURATED){
+      throw std::overflow_error("Overflow, count does not fit in 128 bits");
+    }
+    return count;
+}
+
+std::uint64_t algorithms::soccer_dyn_prog_mod(const std::vector<std::string>& field,
+                                              std::uint64_t modulus) {
+    PackedField packed(field);
+    detail::validate_modulus(modulus);
+    return detail::frontier_count(packed, detail::mod_u64(modulus));
+}
+
+algorithms::BigUnsigned
+algorithms::soccer_dyn_prog_crt(const std::vector<std::string>& field,
+                                const std::vector<std::uint64_t>& moduli) {
+    PackedField packed(field);
+    if(moduli.empty()){
+      throw std::invalid_argument("Invalid, no moduli");
+    }
+    for(auto modulus : moduli){
+      detail::validate_modulus(modulus);
     }
-    //If statement to check if field is 1x1 and contains either . or X
-    if(field.size() == 1 && field[0].size() == 1){
-      if(field[0][0] == '.'){
-        return 1;
+    //One modular pass per modulus
+    std::vector<std::uint64_t> residues;
+    for(auto modulus : moduli){
+      residues.push_back(detail::frontier_count(packed, detail::mod_u64(modulus)));
+    }
+    return detail::crt_combine(residues, moduli);
+}
+
+algorithms::BigUnsigned
+algorithms::detail::crt_combine(const std::vector<std::uint64_t>& residues,
+                                const std::vector<std::uint64_t>& moduli) {
+    //Garner's algorithm: digits[k] is the k-th mixed radix digit of the
+    //answer, so the answer is digits[0] + m0 * (digits[1] + m1 * (...))
+    std::vector<std::uint64_t> digits(moduli.size());
+    for(size_t k = 0; k < moduli.size(); k++){
+      std::uint64_t m = moduli[k];
+      //Evaluates the digits found so far modulo m
+      unsigned __int128 partial = 0, radix = 1;
+      for(size_t l = 0; l < k; l++){
+        partial = (partial + digits[l] % m * radix) % m;
+        radix = radix * (moduli[l] % m) % m;
       }
-      else if(field[0][0] == 'X'){
-        return 0;
+      if(radix == 0 || std::gcd(static_cast<std::uint64_t>(radix), m) != 1){
+        throw std::invalid_argument("Invalid, moduli are not coprime");
       }
-      else{
-        throw std::invalid_argument("Invalid, character");
+      //digits[k] = (residue - partial) / radix (mod m), with the inverse of
+      //radix found by the extended Euclidean algorithm
+      std::int64_t modulus = static_cast<std::int64_t>(m);
+      std::int64_t old_r = static_cast<std::int64_t>(radix), r = modulus;
+      std::int64_t old_s = 1, s = 0;
+      while(r != 0){
+        std::int64_t q = old_r / r;
+        std::int64_t t = old_r - q * r;
+        old_r = r;
+        r = t;
+        t = old_s - q * s;
+        old_s = s;
+        s = t;
       }
+      //old_s is in (-m, m), so one addition makes it nonnegative without
+      //overflowing for moduli near 2^63
+      std::int64_t reduced = old_s % modulus;
+      std::uint64_t inverse = static_cast<std::uint64_t>(reduced < 0 ? reduced + modulus : reduced);
+      std::uint64_t difference = (residues[k] + m - static_cast<std::uint64_t>(partial)) % m;
+      digits[k] = static_cast<std::uint64_t>(static_cast<unsigned __int128>(difference) * inverse % m);
     }
-    int maxrow = field.size();
-    int maxcolumn = field[0].size();
-    //For loop to check if statement contains invalid characters or is an invalid field
-    for(int i = 0; i < maxrow; i++){
-      for(int j = 0; j < maxcolumn; j++){
-        if(field[i][j] != 'X' && field[i][j] != '.'){
-          throw std::invalid_argument("Invalid, character");
-        }
-      }
-      if(field[i].size() != maxcolumn){
-        throw std::invalid_argument("Invalid, row less");
-      }
+    BigUnsigned result;
+    for(size_t k = moduli.size(); k-- > 0; ){
+      result.mul_add_small(moduli[k], digits[k]);
     }
-    int matrixarray[maxrow][maxcolumn];
-    //For loop to set all elements to zero
-    for(int i = 0; i < maxrow; i++){
-      for(int j = 0; j < maxcolumn; j++){
-        matrixarray[i][j] = 0;
-      }
+    return result;
+}
+
+algorithms::BigUnsigned algorithms::soccer_dyn_prog_exact(const std::vector<std::string>& field) {
+    PackedField packed(field);
+    //Fixed-width passes first, promoting only when the count saturates
+    auto narrow = detail::frontier_count(packed, detail::saturating_u64());
+    if(narrow != detail::saturating_u64::SATURATED){
+      return BigUnsigned(narrow);
     }
-    matrixarray[0][0] = 1;
-    //For loop to run through every possible candidate
-    for(int i = 0; i < maxrow; i++){
-      for(int j = 0; j < maxcolumn; j++){
-        //If statement to check if it is impassible
-        if(field[i][j] == 'X'){
-          matrixarray[i][j] = 0;
-        }
-        else{
-          int above = 0;
-          int from_left = 0;
-          //If statement to check if i is greater than 0 and prev element is passible
-          if(i > 0 && field[i - 1][j] == '.'){
-            above = matrixarray[i - 1][j];
-          }
-          //If statement to check if j is greater than 0 and prev element is passible
-          if(j > 0 && field[i][j - 1] == '.'){
-            from_left = matrixarray[i][j - 1];
-          }
-          //adds possible routes to current element
-          matrixarray[i][j] += above + from_left;
-        }
-      }
+    auto wide = detail::frontier_count(packed, detail::saturating_u128());
+    if(wide != detail::saturating_u128::SATURATED){
+      return BigUnsigned(wide);
     }
-    //Returns number of routes that are possible
-    return matrixarray[maxrow - 1][maxcolumn - 1];
+    return detail::frontier_count(packed, detail::exact_big());
 }
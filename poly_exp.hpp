@@ -6,21 +6,152 @@
 // soccer_exhaustive
 // soccer_dyn_prog
 //
+// and for the PackedField bitmap representation they both accept.
+//
 ///////////////////////////////////////////////////////////////////////////////
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <random>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "big_unsigned.hpp"
+
+// Build with SOCCER_STATS defined to 1 (make STATS=1) to count SolveStats.
+#ifndef SOCCER_STATS
+#define SOCCER_STATS 0
+#endif
+
 namespace algorithms {
 
+  // A non-owning view of a play field stored as characters, one row of
+  // '.' and 'X' per line, that the algorithms read without copying.
+  //
+  // The rows may live in
+  //
+  //   a contiguous buffer or memory-mapped region, row i starting at
+  //     base + i * stride (stride > columns skips line terminators),
+  //   a std::vector<std::string>, or
+  //   an array of std::string_view.
+  //
+  // The view does not validate anything; the algorithms do, exactly as
+  // they validate a std::vector<std::string>. The viewed characters must
+  // outlive the view.
+  class FieldView {
+  private:
+    enum class Layout { strided, strings, views };
+
+    Layout _layout;
+    const void* _rows_data;
+    size_t _rows, _columns, _stride;
+
+  public:
+    FieldView(const char* base, size_t rows, size_t columns, size_t stride)
+      : _layout(Layout::strided), _rows_data(base), _rows(rows),
+        _columns(columns), _stride(stride) {}
+
+    FieldView(const std::vector<std::string>& field)
+      : _layout(Layout::strings), _rows_data(field.data()),
+        _rows(field.size()), _columns(field.empty() ? 0 : field[0].size()),
+        _stride(0) {}
+
+    FieldView(const std::string_view* rows, size_t count)
+      : _layout(Layout::views), _rows_data(rows), _rows(count),
+        _columns(count == 0 ? 0 : rows[0].size()), _stride(0) {}
+
+    // Rows, and columns of the first row.
+    size_t rows() const { return _rows; }
+    size_t columns() const { return _columns; }
+
+    // Characters of row i, and how many there are; only rows() are checked
+    // against columns().
+    const char* row(size_t i) const {
+      switch (_layout) {
+      case Layout::strings:
+        return static_cast<const std::string*>(_rows_data)[i].data();
+      case Layout::views:
+        return static_cast<const std::string_view*>(_rows_data)[i].data();
+      default:
+        return static_cast<const char*>(_rows_data) + i * _stride;
+      }
+    }
+
+    size_t row_size(size_t i) const {
+      switch (_layout) {
+      case Layout::strings:
+        return static_cast<const std::string*>(_rows_data)[i].size();
+      case Layout::views:
+        return static_cast<const std::string_view*>(_rows_data)[i].size();
+      default:
+        return _columns;
+      }
+    }
+  };
+
+  // A play field stored as one bit per cell: bit j of row i is set when cell
+  // (i, j) is passable ('.') and clear when it is impassable ('X').
+  //
+  // Each row occupies stride() 64-bit words, least significant bit first.
+  // The stride is padded to a multiple of WORD_ALIGN words so rows can be
+  // read with full-width vector loads, and the padding bits are always clear.
+  // Compared to std::vector<std::string> this is 8x smaller.
+  class PackedField {
+  private:
+    size_t _rows, _columns, _stride;
+    std::vector<std::uint64_t> _words;
+
+  public:
+
+    static const size_t WORD_BITS = 64, WORD_ALIGN = 4;
+
+    // Validate and pack field in a single vectorized sweep.
+    //
+    // Throws std::invalid_argument if field is invalid (empty, misshapen, or
+    // contains invalid characters), like the algorithms below.
+    explicit PackedField(const std::vector<std::string>& field);
+
+    explicit PackedField(FieldView field);
+
+    // Create a rows x columns field of impassable cells.
+    //
+    // Throws std::invalid_argument if rows or columns is zero, or if the
+    // field has more words than a size_t counts.
+    PackedField(size_t rows, size_t columns);
+
+    size_t rows() const { return _rows; }
+    size_t columns() const { return _columns; }
+    size_t stride() const { return _stride; }
+
+    const std::uint64_t* row(size_t i) const { return &_words[i * _stride]; }
+    std::uint64_t* row(size_t i) { return &_words[i * _stride]; }
+
+    bool open(size_t i, size_t j) const {
+      return (row(i)[j / WORD_BITS] >> (j % WORD_BITS)) & 1;
+    }
+
+    void set_open(size_t i, size_t j, bool passable) {
+      std::uint64_t bit = std::uint64_t{1} << (j % WORD_BITS);
+      if (passable) {
+        row(i)[j / WORD_BITS] |= bit;
+      } else {
+        row(i)[j / WORD_BITS] &= ~bit;
+      }
+    }
+  };
+
   // Each of these functions solves the *soccer opponent avoidance problem*.
   //
   // soccer_exhaustive uses exhaustive search and takes exponential time.
-  // soccer_dyn_prog uses dynamic programming and takes quadratic time.
+  // soccer_dyn_prog uses dynamic programming and takes quadratic time. It
+  // keeps a single frontier line of the table on the heap, so its workspace
+  // is O(min(r, c)) regardless of how large the field is.
   //
-  // field is a vector of strings that defines a play field.
+  // field is a vector of strings, or a FieldView, that defines a play field.
   //   So field[i] is row i, and field[i][j] is the cell at row i, column j.
   //   Each character must be '.' (passable) or 'X' (impassable).
   //   The number of rows and columns must both be positive.
@@ -34,9 +165,565 @@ namespace algorithms {
   //
   // In addition, soccer_exhaustive throws std::invalid_argument if n > 31,
   // where n = r + c - 2.
+  //
+  // Both algorithms also accept an already validated PackedField, which
+  // skips the validation and packing pass.
+  //
+  // The overloads taking a SolveStats also count the work they do into
+  // stats, see below.
+
+  int soccer_exhaustive(const std::vector<std::string>& field);
+
+  int soccer_exhaustive(FieldView field);
+
+  int soccer_exhaustive(const PackedField& field);
+
+  int soccer_dyn_prog(const std::vector<std::string>& field);
+
+  int soccer_dyn_prog(FieldView field);
+
+  int soccer_dyn_prog(const PackedField& field);
+
+  // Counters of the work one call of soccer_exhaustive or soccer_dyn_prog
+  // did, each algorithm filling in its own half.
+  //
+  // They are opt-in: unless the algorithms are built with SOCCER_STATS
+  // defined to 1, ENABLED is false, the counting code is compiled out, and
+  // every counter stays zero. Even when they are built in, only the calls
+  // given a SolveStats count anything. Each such call resets stats first.
+  struct SolveStats {
+    static constexpr bool ENABLED = SOCCER_STATS;
+
+    // soccer_exhaustive: candidates generated (2^n), the candidates that
+    // stopped on an 'X' or by leaving the grid, and the moves tested over
+    // all candidates, including the move that stopped one. A candidate
+    // whose start cell is an 'X' stops on it after 0 moves.
+    std::uint64_t candidates_generated{0},
+      candidates_killed_by_obstacle{0},
+      candidates_killed_leaving_grid{0},
+      prefix_moves{0};
+
+    // soccer_dyn_prog: cells the DP swept, impassable cells among them,
+    // and the peak bytes of the packed field and DP workspace.
+    std::uint64_t cells_visited{0},
+      obstacle_cells_skipped{0},
+      peak_workspace_bytes{0};
+
+    // Average moves tested per candidate.
+    double average_prefix_depth() const {
+      return (candidates_generated == 0) ? 0
+        : double(prefix_moves) / candidates_generated;
+    }
+  };
+
+  int soccer_exhaustive(FieldView field, SolveStats& stats);
+
+  int soccer_exhaustive(const PackedField& field, SolveStats& stats);
+
+  int soccer_dyn_prog(FieldView field, SolveStats& stats);
+
+  int soccer_dyn_prog(const PackedField& field, SolveStats& stats);
+
+  // Pruned exhaustive search.
+  //
+  // soccer_exhaustive_dfs enumerates the same move sequences as
+  // soccer_exhaustive, depth first, and skips every candidate that shares a
+  // prefix already known to leave the grid or touch an 'X'. It is still a
+  // brute-force count, independent of the dynamic programming solvers, and
+  // its running time grows with the number of valid prefixes.
+  //
+  // The top levels of the search tree are split into tasks for the given
+  // number of threads (0 means one per hardware thread), which run on the
+  // shared ThreadPool; with 1 the calling thread searches alone.
+  //
+  // Throws std::invalid_argument if field is invalid, or if n > 63, where
+  // n = r + c - 2, so that every candidate fits in a 64-bit mask.
+
+  std::uint64_t soccer_exhaustive_dfs(const std::vector<std::string>& field,
+                                      size_t threads = 1);
+
+  std::uint64_t soccer_exhaustive_dfs(const PackedField& field,
+                                      size_t threads = 1);
+
+  // Meet-in-the-middle exhaustive search.
+  //
+  // soccer_exhaustive_mitm enumerates, one by one, every valid half-path
+  // from the top-left corner to the middle anti-diagonal and every valid
+  // half-path back from the bottom-right corner to it, then pairs the halves
+  // that meet at the same diagonal cell. It is a brute-force count in
+  // O(2^(n/2)) time, with no dynamic programming over the grid.
+  //
+  // Throws std::invalid_argument if field is invalid, or if n > 64, where
+  // n = r + c - 2.
+
+  std::uint64_t soccer_exhaustive_mitm(const std::vector<std::string>& field);
+
+  std::uint64_t soccer_exhaustive_mitm(const PackedField& field);
+
+  // Result modes for soccer_dyn_prog.
+  //
+  // soccer_dyn_prog itself counts modulo 2^32, so its int result wraps on
+  // large fields. The functions below take the same field, validate it the
+  // same way, and differ only in the arithmetic used for the counts.
+  //
+  // soccer_dyn_prog_u64 and soccer_dyn_prog_u128 return the exact count and
+  // throw std::overflow_error if it does not fit in 64 (resp. 128) bits.
+  //
+  // soccer_dyn_prog_mod returns the count modulo modulus, which must be at
+  // least 2 and below 2^63 (typically a prime).
+  //
+  // soccer_dyn_prog_crt counts modulo each of the pairwise coprime moduli and
+  // combines the residues with the Chinese remainder theorem, returning the
+  // count modulo the product of the moduli. That is the exact count whenever
+  // the product exceeds it. Throws std::invalid_argument if moduli is empty
+  // or not pairwise coprime.
+  //
+  // soccer_dyn_prog_exact returns the exact count. It runs in 64-bit
+  // arithmetic and promotes to 128 bits, then to BigUnsigned, only when the
+  // narrower count overflows.
+
+  std::uint64_t soccer_dyn_prog_u64(const std::vector<std::string>& field);
+
+  unsigned __int128 soccer_dyn_prog_u128(const std::vector<std::string>& field);
+
+  std::uint64_t soccer_dyn_prog_mod(const std::vector<std::string>& field,
+                                    std::uint64_t modulus);
+
+  BigUnsigned soccer_dyn_prog_crt(const std::vector<std::string>& field,
+                                  const std::vector<std::uint64_t>& moduli);
+
+  BigUnsigned soccer_dyn_prog_exact(const std::vector<std::string>& field);
+
+  // Multi-threaded soccer_dyn_prog for very large fields.
+  //
+  // The field is split into tiles that are solved along anti-diagonal
+  // wavefronts, each tile needing only the boundary counts above and to the
+  // left of it. At most threads tiles (0 means one per hardware thread) are
+  // solved at once, on the shared ThreadPool, so no threads are started
+  // per call.
+  //
+  // Returns the count modulo modulus, which must be 0 or a valid modulus for
+  // soccer_dyn_prog_mod. When modulus is 0 the exact count is returned, and
+  // std::overflow_error is thrown if it does not fit in 64 bits. The results
+  // are identical to the serial result modes for any thread count.
+
+  std::uint64_t soccer_dyn_prog_parallel(const std::vector<std::string>& field,
+                                         size_t threads = 0,
+                                         std::uint64_t modulus = 0);
+
+  std::uint64_t soccer_dyn_prog_parallel(const PackedField& field,
+                                         size_t threads = 0,
+                                         std::uint64_t modulus = 0);
+
+  // Batch solver for many small fields.
+  //
+  // soccer_dyn_prog_batch solves fields[0..count) in parallel on the shared
+  // ThreadPool and writes the outcome for fields[k] to out[k]. A field that
+  // is invalid, or whose count does not fit, is reported in its own slot
+  // instead of failing the whole batch. The counts follow the modulus
+  // convention of soccer_dyn_prog_parallel.
+  //
+  // Returns the number of fields with status ok. Throws
+  // std::invalid_argument only if modulus is invalid.
+
+  enum class BatchStatus {
+    ok,        // count holds the result
+    invalid,   // the field is empty, misshapen, or has invalid characters
+    overflow,  // modulus is 0 and the count does not fit in 64 bits
+  };
+
+  struct BatchCount {
+    std::uint64_t count;
+    BatchStatus status;
+  };
+
+  size_t soccer_dyn_prog_batch(const std::vector<std::string>* fields,
+                               size_t count, BatchCount* out,
+                               std::uint64_t modulus = 0);
+
+  // Resizes out to fields.size(); its capacity is reused across calls.
+  size_t soccer_dyn_prog_batch(const std::vector<std::vector<std::string>>& fields,
+                               std::vector<BatchCount>& out,
+                               std::uint64_t modulus = 0);
+
+  // Streaming solver for fields stored as text files.
+  //
+  // soccer_dyn_prog_file solves the field in the file at path, one row per
+  // line, each line ending in '\n' or "\r\n" (optional after the last
+  // row). The file is memory-mapped and read once, front to back, keeping
+  // only the DP frontier, so memory use does not grow with the number of
+  // rows. Counts follow the modulus convention of soccer_dyn_prog_parallel.
+  //
+  // Throws std::invalid_argument for invalid fields, as soccer_dyn_prog
+  // does, naming the 1-based line of a misshapen row or invalid character.
+  // Throws std::system_error if the file cannot be opened or mapped.
+
+  std::uint64_t soccer_dyn_prog_file(const std::string& path,
+                                     std::uint64_t modulus = 0);
+
+  // Binary .sfld fields.
+  //
+  // An .sfld file holds a header with the number of rows and columns and a
+  // checksum, then one record per row: either the row's passable bits, or
+  // the lengths of its alternating runs of '.' and 'X', whichever is
+  // smaller. A row with few obstacles or few passable cells takes a few
+  // bytes. The layout is described in field_file.cpp.
+  //
+  // soccer_dyn_prog_sfld solves an .sfld file like soccer_dyn_prog_file,
+  // streaming the rows and advancing the frontier a whole run at a time on
+  // rows stored as runs. load_sfld reads an .sfld file into memory.
+  // save_sfld writes field as an .sfld file, and convert_text_to_sfld
+  // converts a text field file, streaming it row by row. Both write next
+  // to the target and rename over it when done, so the target is never
+  // left half written.
+  //
+  // Readers throw std::invalid_argument if the file is not a valid .sfld
+  // file or its checksum does not match, and converters if the text field
+  // is invalid, as soccer_dyn_prog_file does. All throw std::system_error
+  // if a file cannot be opened, mapped, or written.
+
+  std::uint64_t soccer_dyn_prog_sfld(const std::string& path,
+                                     std::uint64_t modulus = 0);
+
+  PackedField load_sfld(const std::string& path);
+
+  void save_sfld(const PackedField& field, const std::string& path);
+
+  void convert_text_to_sfld(const std::string& text_path,
+                            const std::string& sfld_path);
+
+  // Keeps the DP state of one field so that the count can be updated as
+  // individual cells change, instead of solving the whole field again.
+  //
+  // The field is cut into tiles, and the counts along the bottom row and
+  // right column of every tile are cached. A changed cell only dirties its
+  // own tile; count() recomputes dirty tiles in order from their cached
+  // top and left boundaries, and dirties a neighbour below or to the right
+  // only when a boundary it reads actually changed. A change near the
+  // bottom-right corner therefore recomputes a single tile.
+  //
+  // Counts follow the modulus convention of soccer_dyn_prog_parallel.
+  //
+  // How to use:
+  //
+  //    IncrementalSoccerSolver solver(field);
+  //    solver.set_cell(3, 4, true);        // an opponent moves in
+  //    solver.set_cell(3, 5, false);       // and out again
+  //    std::uint64_t routes = solver.count();
+  class IncrementalSoccerSolver {
+  public:
+    static const size_t TILE_ROWS = 64, TILE_COLUMNS = 256;
+
+    // Throws std::invalid_argument if field or modulus is invalid.
+    explicit IncrementalSoccerSolver(const std::vector<std::string>& field,
+                                     std::uint64_t modulus = 0);
+
+    explicit IncrementalSoccerSolver(PackedField field,
+                                     std::uint64_t modulus = 0);
+
+    const PackedField& field() const { return _field; }
+
+    // Make cell (i, j) impassable ('X') when blocked, passable otherwise.
+    //
+    // Throws std::invalid_argument if (i, j) is outside the field.
+    void set_cell(size_t i, size_t j, bool blocked);
+
+    // The number of routes through the current field. Throws
+    // std::overflow_error if modulus is 0 and the count does not fit.
+    std::uint64_t count();
+
+  private:
+    PackedField _field;
+    std::uint64_t _modulus;
+    size_t _tile_rows_count, _tile_columns_count;
+    // _bottom[p * columns + j]: count of the last row of tile row p, column j
+    // _right[q * rows + i]: count of row i, last column of tile column q
+    std::vector<std::uint64_t> _bottom, _right, _scratch;
+    std::vector<char> _dirty;
+    // no tile before this one, in row-major order, is dirty
+    size_t _first_dirty;
+
+    template <typename Arith>
+    void update(const Arith& arith);
+
+    template <typename Arith>
+    void solve_tile(size_t p, size_t q, const Arith& arith);
+  };
+
+  // A cell whose blocking would remove through routes, as reported by
+  // PathCountTables::critical_cells.
+  struct CriticalCell {
+    size_t row, column;
+    std::uint64_t through;
+  };
+
+  // Route counts from the top-left corner to every cell, and from every
+  // cell to the bottom-right corner, computed in one DP pass each. Every
+  // route through cell (i, j) is a route to (i, j) followed by a route from
+  // it, so the queries below take O(1) time each instead of a new solve.
+  //
+  // Counts follow the modulus convention of soccer_dyn_prog_parallel; the
+  // constructor throws std::overflow_error if modulus is 0 and the total
+  // does not fit in 64 bits. No count through a single cell can then be
+  // larger than the total. Queries throw std::invalid_argument if (i, j) is
+  // outside the field.
+  class PathCountTables {
+  public:
+    // Throws std::invalid_argument if field or modulus is invalid.
+    explicit PathCountTables(const std::vector<std::string>& field,
+                             std::uint64_t modulus = 0);
+
+    explicit PathCountTables(const PackedField& field,
+                             std::uint64_t modulus = 0);
+
+    size_t rows() const { return _rows; }
+    size_t columns() const { return _columns; }
+
+    // The number of routes, as soccer_dyn_prog_u64 or soccer_dyn_prog_mod.
+    std::uint64_t count() const { return _count; }
+
+    // The number of routes that pass through cell (i, j).
+    std::uint64_t through(size_t i, size_t j) const;
+
+    // The number of routes left if cell (i, j) were also blocked.
+    std::uint64_t count_if_blocked(size_t i, size_t j) const;
+
+    // The k cells with the most routes through them, most first, ties in
+    // row-major order. Cells no route passes through are never reported,
+    // so fewer than k cells may be returned. Rows are scanned in parallel
+    // on the shared ThreadPool.
+    //
+    // Throws std::invalid_argument if the counts are taken modulo a
+    // modulus, since residues cannot be ranked.
+    std::vector<CriticalCell> critical_cells(size_t k) const;
+
+    // Routes as strings of r + c - 2 moves, 'v' for down and '>' for
+    // right, ranked 0 to count() - 1 in lexicographic order with 'v' before
+    // '>', so the route that goes down as early as possible comes first.
+    // Every move is chosen from the routes from the next cell, which makes
+    // unrank and rank O(r + c).
+    //
+    // These, too, throw std::invalid_argument if the counts are taken
+    // modulo a modulus.
+    class PathIterator;
+
+    // The route of rank k. Throws std::invalid_argument if k >= count().
+    std::string unrank(std::uint64_t k) const;
+
+    // The rank of path. Throws std::invalid_argument if path is not a
+    // route of the field.
+    std::uint64_t rank(const std::string& path) const;
+
+    // Iterators over the routes in rank order, from the route of rank k
+    // (paths_end() if k >= count()). Moving to the next route only redoes
+    // the moves after the last 'v' that can become a '>', which on open
+    // fields is O(1) moves amortized.
+    PathIterator paths_begin(std::uint64_t k = 0) const;
+    PathIterator paths_end() const;
+
+  private:
+    size_t _rows, _columns;
+    std::uint64_t _modulus, _count;
+    // _forward[i * columns + j]: routes from (0, 0) to (i, j)
+    // _backward[i * columns + j]: routes from (i, j) to (r - 1, c - 1)
+    std::vector<std::uint64_t> _forward, _backward;
+
+    void check_cell(size_t i, size_t j) const;
+
+    void check_exact(const char* message) const;
+
+    // Routes from (i, j) to the goal, 0 outside the field.
+    std::uint64_t routes_from(size_t i, size_t j) const {
+      return (i < _rows && j < _columns) ? _backward[i * _columns + j] : 0;
+    }
+  };
+
+  class PathCountTables::PathIterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::string;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const std::string*;
+    using reference = const std::string&;
+
+    PathIterator() = default;
+
+    reference operator*() const { return _path; }
+    pointer operator->() const { return &_path; }
+
+    PathIterator& operator++();
+
+    PathIterator operator++(int) {
+      PathIterator before(*this);
+      ++*this;
+      return before;
+    }
+
+    bool operator==(const PathIterator& other) const {
+      return _done == other._done && (_done || _path == other._path);
+    }
+
+    bool operator!=(const PathIterator& other) const { return !(*this == other); }
+
+  private:
+    friend class PathCountTables;
+
+    const PathCountTables* _tables{nullptr};
+    std::string _path;
+    bool _done{true};
+  };
+
+  // Draws routes of a field uniformly at random.
+  //
+  // Like PathCountTables::unrank, a route is drawn one move at a time,
+  // going down with probability (routes from the cell below) / (routes
+  // from the current cell), in O(r + c) time from a table of routes to
+  // the goal built once. When the count fits in 64 bits the draw is exact:
+  // a rank k uniform below the count, by rejection, is unranked. Larger
+  // counts are kept as log2 counts in doubles, and every cell's
+  // probability of going down as a 63-bit threshold that one random word
+  // is compared against, which is uniform up to the rounding of the
+  // doubles, a relative error of about 1e-13 per route.
+  //
+  // A batch draws route k from its own splitmix64 stream, seeded from the
+  // batch seed and k, so a batch only depends on the seed, never on the
+  // threads of the shared ThreadPool that draw it.
+  //
+  // How to use:
+  //
+  //    PathSampler sampler(field);
+  //    std::mt19937_64 rng(seed);
+  //    std::vector<char> moves = sampler.sample(1000000, rng);
+  //    // route k is moves[k * sampler.path_length()] onwards
+  class PathSampler {
+  public:
+    // Throws std::invalid_argument if field is invalid or has no routes.
+    explicit PathSampler(const std::vector<std::string>& field);
+
+    explicit PathSampler(const PackedField& field);
+
+    size_t rows() const { return _rows; }
+    size_t columns() const { return _columns; }
+
+    // Moves of a route, r + c - 2.
+    size_t path_length() const { return _rows + _columns - 2; }
+
+    // Whether the count fits in 64 bits, so that draws are exactly uniform.
+    bool exact() const { return _exact; }
+
+    // log2 of the number of routes.
+    double log2_count() const;
+
+    // n routes of path_length() moves each, 'v' or '>', one after the
+    // other, seeded by one 64-bit draw from rng.
+    template <class Rng>
+    std::vector<char> sample(size_t n, Rng& rng) const {
+      return sample_seeded(n, std::uniform_int_distribution<std::uint64_t>()(rng));
+    }
+
+    // One route.
+    template <class Rng>
+    std::string sample(Rng& rng) const {
+      const std::vector<char> moves = sample(1, rng);
+      return std::string(moves.begin(), moves.end());
+    }
+
+    std::vector<char> sample_seeded(size_t n, std::uint64_t seed) const;
+
+  private:
+    size_t _rows, _columns;
+    bool _exact;
+    // exact: routes from each cell to the goal, row-major; otherwise each
+    // cell's probability of going down, times 2^63
+    std::vector<std::uint64_t> _table;
+    double _log2_count;
+
+  };
+
+
+  // Sparse fields.
+  //
+  // A rows x columns field may also be given by the list of its impassable
+  // cells, which is far smaller than the field when there are few of them.
+  // Obstacles may repeat and may be in any order.
+  struct FieldCell {
+    size_t row, column;
+  };
+
+  // soccer_sparse counts the routes by inclusion-exclusion over the
+  // obstacles, sorted so that every route meets them in order: with the
+  // goal as obstacle k, the routes whose first obstacle is i number
+  //
+  //   f(i) = paths((0, 0), i) - sum of f(j) * paths(j, i) over obstacles
+  //          j that a route can visit before i,
+  //
+  // where paths(a, b) is a binomial coefficient, and f(k) is the count.
+  // It takes O(r + c + k^2) time for k obstacles, however large the field,
+  // using factorial and inverse factorial tables modulo a prime.
+  //
+  // When modulus is nonzero it must be a prime greater than r + c - 2 and
+  // below 2^63, and the count modulo modulus is returned. When modulus is
+  // 0 the exact count is returned, and std::overflow_error is thrown if it
+  // does not fit in 64 bits. soccer_sparse_exact returns the exact count of
+  // any size; both count modulo as many primes near 2^63 as the count
+  // needs, and combine the residues with the Chinese remainder theorem.
+  //
+  // Throws std::invalid_argument if rows or columns is zero, an obstacle
+  // is outside the field, or modulus is invalid.
+  std::uint64_t soccer_sparse(size_t rows, size_t columns,
+                              const std::vector<FieldCell>& obstacles,
+                              std::uint64_t modulus = 0);
+
+  BigUnsigned soccer_sparse_exact(size_t rows, size_t columns,
+                                  const std::vector<FieldCell>& obstacles);
+
+  // soccer_count_obstacles solves the field with soccer_sparse or with
+  // soccer_dyn_prog_parallel, whichever an estimate of their costs
+  // (k^2 obstacle pairs against r * c cells) says is cheaper. Fields that
+  // are too dense, or a modulus soccer_sparse cannot use, go to the DP. The
+  // result and exceptions are those of soccer_dyn_prog_parallel.
+  std::uint64_t soccer_count_obstacles(size_t rows, size_t columns,
+                                       const std::vector<FieldCell>& obstacles,
+                                       std::uint64_t modulus = 0);
+
+
+  // Fields of repeated rows.
+  //
+  // A tall field may also be given as a list of row blocks stacked top to
+  // bottom, each block's rows repeated repetitions times in a row, so that
+  // a field of 10^12 rows takes a few strings to describe.
+  struct RowBlock {
+    std::vector<std::string> rows;
+    std::uint64_t repetitions;
+  };
+
+  // soccer_repeated counts the routes of the field blocks describe. One
+  // pass over a block's rows maps the frontier line of counts above the
+  // block to the line below it, and that map is linear: a c x c transfer
+  // matrix, lower triangular since routes only move right along a line.
+  // A block repeated n times applies the n-th power of its matrix, found
+  // by repeated squaring in O(c^3 log n) time for c columns. Blocks whose
+  // matrix would cost more than sweeping their rows are swept instead.
+  //
+  // Counts follow the modulus convention of soccer_dyn_prog_parallel.
+  //
+  // Throws std::invalid_argument if the field has no rows or columns, its
+  // rows differ in length or contain invalid characters, or modulus is
+  // invalid.
+  std::uint64_t soccer_repeated(const std::vector<RowBlock>& blocks,
+                                std::uint64_t modulus = 0);
+
+  // The runs of repeated row blocks of field, each block at most
+  // MAX_BLOCK_ROWS rows: from the top, the block whose repeats cover the
+  // most rows, the shortest among ties, is taken whenever it repeats;
+  // other rows are gathered into blocks of one repetition.
+  const size_t MAX_BLOCK_ROWS = 64;
 
-  int soccer_exhaustive(const std::vector<std::string> field);
+  std::vector<RowBlock> find_row_blocks(const std::vector<std::string>& field);
 
-  int soccer_dyn_prog(const std::vector<std::string> field);
+  // soccer_repeated of find_row_blocks(field), the same count as
+  // soccer_dyn_prog_parallel.
+  std::uint64_t soccer_dyn_prog_periodic(const std::vector<std::string>& field,
+                                         std::uint64_t modulus = 0);
 
 }
@@ -6,12 +6,20 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <random>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "gtest/gtest.h"
 
 #include "poly_exp.hpp"
+#include "dp_kernels.hpp"
+#include "exhaustive_kernels.hpp"
+#include "fixed_shape.hpp"
+#include "solve_cache.hpp"
 
 std::vector<std::string> make_field(size_t r, size_t c, char cell = '.') {
   assert((cell == '.') || (cell == 'X'));
@@ -33,6 +41,29 @@ std::vector<std::string> make_field_n(size_t n) {
   return field;
 }
 
+std::vector<std::string> make_random_field(size_t r, size_t c, unsigned x_percent,
+                                           std::mt19937_64& rng) {
+  auto field = make_field(r, c);
+  for (auto& row : field) {
+    for (auto& cell : row) {
+      if ((rng() % 100) < x_percent) {
+        cell = 'X';
+      }
+    }
+  }
+  return field;
+}
+
+std::vector<std::string> transpose_field(const std::vector<std::string>& field) {
+  std::vector<std::string> result(field[0].size(), std::string(field.size(), '.'));
+  for (size_t i = 0; i < field.size(); ++i) {
+    for (size_t j = 0; j < field[i].size(); ++j) {
+      result[j][i] = field[i][j];
+    }
+  }
+  return result;
+}
+
 TEST(soccer_exhaustive_invalid_argument, invalid_argument) {
 
   // valid field
@@ -609,4 +640,1398 @@ TEST(soccer_dyn_prog_large_instances, large_instances) {
     // do not test the return value because it may overflow
     EXPECT_NO_THROW(algorithms::soccer_dyn_prog(field));
   }
+
+  // 10000x10000, impassible
+  {
+    std::vector<std::string> field(10000, std::string(10000, 'X'));
+    field[0][0] = field[9999][9999] = '.';
+    EXPECT_EQ(0, algorithms::soccer_dyn_prog(field));
+  }
+
+  // 50000x2000, single corridor down the left edge and along the bottom
+  {
+    std::vector<std::string> field(50000, std::string(2000, 'X'));
+    for (auto& row : field) {
+      row[0] = '.';
+    }
+    field[49999] = std::string(2000, '.');
+    EXPECT_EQ(1, algorithms::soccer_dyn_prog(field));
+  }
+}
+
+TEST(soccer_dyn_prog_result_modes, result_modes) {
+
+  // all modes agree on a small field
+  std::vector<std::string> small{"......X.X",
+                                 "X........",
+                                 "...X...X.",
+                                 "..X....X.",
+                                 ".X....X..",
+                                 "....X....",
+                                 "..X.....X",
+                                 "........."};
+  EXPECT_EQ(102, algorithms::soccer_dyn_prog_u64(small));
+  EXPECT_TRUE(102 == algorithms::soccer_dyn_prog_u128(small));
+  EXPECT_EQ(102 % 7, algorithms::soccer_dyn_prog_mod(small, 7));
+  EXPECT_EQ("102", algorithms::soccer_dyn_prog_exact(small).to_string());
+  EXPECT_EQ("102", algorithms::soccer_dyn_prog_crt(small, {7, 11, 13}).to_string());
+  EXPECT_EQ(0, algorithms::soccer_dyn_prog_u64({"X"}));
+
+  // 34x34 passable, C(66, 33) is the largest central binomial in 64 bits
+  {
+    std::vector<std::string> field(34, std::string(34, '.'));
+    EXPECT_EQ(7219428434016265740ULL, algorithms::soccer_dyn_prog_u64(field));
+  }
+
+  // 60x60 passable, C(118, 59) needs 128 bits
+  {
+    std::vector<std::string> field(60, std::string(60, '.'));
+    EXPECT_THROW(algorithms::soccer_dyn_prog_u64(field), std::overflow_error);
+    auto count = algorithms::soccer_dyn_prog_u128(field);
+    EXPECT_EQ("24356699707654619143838606602026720",
+              algorithms::BigUnsigned(count).to_string());
+  }
+
+  // 100x100 passable, C(198, 99) overflows every fixed-width mode
+  {
+    std::vector<std::string> field(100, std::string(100, '.'));
+    const std::string expected =
+      "22750883079422934966181954039568885395604168260154104734000";
+    EXPECT_THROW(algorithms::soccer_dyn_prog_u128(field), std::overflow_error);
+    EXPECT_EQ(expected, algorithms::soccer_dyn_prog_exact(field).to_string());
+    EXPECT_EQ(690285631, algorithms::soccer_dyn_prog_mod(field, 1000000007));
+    EXPECT_EQ(927103106, algorithms::soccer_dyn_prog_mod(field, 998244353));
+    EXPECT_EQ(expected,
+              algorithms::soccer_dyn_prog_crt(field, {4611686018427387847ULL,
+                                                      4611686018427387817ULL,
+                                                      4611686018427387787ULL,
+                                                      1000000007}).to_string());
+  }
+
+  // invalid moduli
+  EXPECT_THROW(algorithms::soccer_dyn_prog_mod(small, 0), std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_dyn_prog_mod(small, 1), std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_dyn_prog_crt(small, {}), std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_dyn_prog_crt(small, {6, 9}), std::invalid_argument);
+
+  // invalid fields
+  EXPECT_THROW(algorithms::soccer_dyn_prog_u64({ }), std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_dyn_prog_exact({"..", "."}), std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_dyn_prog_mod({"a."}, 7), std::invalid_argument);
+}
+
+TEST(packed_field, packed_field) {
+
+  // bits match the string form, including across word boundaries
+  std::vector<std::string> field(3, std::string(150, '.'));
+  field[0][0] = field[1][63] = field[1][64] = field[2][149] = 'X';
+  algorithms::PackedField packed(field);
+  EXPECT_EQ(3, packed.rows());
+  EXPECT_EQ(150, packed.columns());
+  EXPECT_EQ(0, packed.stride() % algorithms::PackedField::WORD_ALIGN);
+  for (size_t i = 0; i < field.size(); ++i) {
+    for (size_t j = 0; j < field[i].size(); ++j) {
+      EXPECT_EQ(field[i][j] == '.', packed.open(i, j));
+    }
+    // padding bits stay clear
+    EXPECT_EQ(0, packed.row(i)[2] >> (150 - 128));
+    EXPECT_EQ(0, packed.row(i)[3]);
+  }
+
+  // same validation as the algorithms
+  EXPECT_THROW(algorithms::PackedField({ }), std::invalid_argument);
+  EXPECT_THROW(algorithms::PackedField({ {}, {}, {} }), std::invalid_argument);
+  EXPECT_THROW(algorithms::PackedField(0, 5), std::invalid_argument);
+  for (size_t j : {0, 31, 63, 64, 100, 149}) {
+    auto invalid = field;
+    invalid[1][j] = 'x';
+    EXPECT_THROW(algorithms::PackedField{invalid}, std::invalid_argument);
+    auto misshapen = field;
+    misshapen[2].resize(j);
+    EXPECT_THROW(algorithms::PackedField{misshapen}, std::invalid_argument);
+  }
+
+  // both algorithms accept packed fields directly
+  std::vector<std::string> general{"......X.X",
+                                   "X........",
+                                   "...X...X.",
+                                   "..X....X.",
+                                   ".X....X..",
+                                   "....X....",
+                                   "..X.....X",
+                                   "........."};
+  algorithms::PackedField packed_general(general);
+  EXPECT_EQ(102, algorithms::soccer_exhaustive(packed_general));
+  EXPECT_EQ(102, algorithms::soccer_dyn_prog(packed_general));
+
+  // set_open edits are seen by the algorithms
+  algorithms::PackedField empty(2, 2);
+  EXPECT_EQ(0, algorithms::soccer_dyn_prog(empty));
+  empty.set_open(0, 0, true);
+  empty.set_open(0, 1, true);
+  empty.set_open(1, 1, true);
+  EXPECT_EQ(1, algorithms::soccer_exhaustive(empty));
+  EXPECT_EQ(1, algorithms::soccer_dyn_prog(empty));
+
+  // an impassable start has no routes in either algorithm
+  EXPECT_EQ(0, algorithms::soccer_exhaustive( {"X.",
+                                               ".."} ));
+  EXPECT_EQ(0, algorithms::soccer_dyn_prog( {"X.",
+                                             ".."} ));
+}
+
+TEST(soccer_dyn_prog_simd_kernels, simd_kernels) {
+
+  // The 64-bit modes run the SIMD line kernels; the exact BigUnsigned mode
+  // runs the generic one, so comparing them cross-checks the kernels on
+  // every chunk alignment, density, and orientation.
+  std::mt19937_64 rng(20);
+  const std::uint64_t MODULUS = 1000000007;
+  for (size_t r : {1, 2, 3, 7, 8, 9, 63, 64, 65, 130}) {
+    for (size_t c : {1, 2, 5, 8, 17, 64, 67, 200}) {
+      for (unsigned x_percent : {0, 10, 40}) {
+        auto field = make_random_field(r, c, x_percent, rng);
+        auto exact = algorithms::soccer_dyn_prog_exact(field);
+        EXPECT_EQ(exact.mod_small(MODULUS),
+                  algorithms::soccer_dyn_prog_mod(field, MODULUS));
+        EXPECT_EQ(static_cast<int>(static_cast<std::uint32_t>(exact.mod_small(std::uint64_t{1} << 32))),
+                  algorithms::soccer_dyn_prog(field));
+        if (exact.fits_u64() && exact.to_u64() != UINT64_MAX) {
+          EXPECT_EQ(exact.to_u64(), algorithms::soccer_dyn_prog_u64(field));
+        } else {
+          EXPECT_THROW(algorithms::soccer_dyn_prog_u64(field), std::overflow_error);
+        }
+        // routes are symmetric under transposition, which swaps the row
+        // and column sweeps
+        EXPECT_EQ(algorithms::soccer_dyn_prog_mod(field, MODULUS),
+                  algorithms::soccer_dyn_prog_mod(transpose_field(field), MODULUS));
+      }
+    }
+  }
+}
+
+TEST(soccer_dyn_prog_parallel, parallel) {
+
+  // matches the serial modes for every thread count, including more than
+  // the shared pool has, on fields with one tile, a single tile row or
+  // column, and many partial tiles
+  std::mt19937_64 rng(5);
+  const std::uint64_t MODULUS = 1000000007;
+  for (auto shape : std::vector<std::pair<size_t, size_t>>{{1, 1}, {3, 700}, {700, 3},
+                                                           {300, 300}, {600, 1300},
+                                                           {1100, 900}}) {
+    for (unsigned x_percent : {0, 10, 45}) {
+      auto field = make_random_field(shape.first, shape.second, x_percent, rng);
+      algorithms::PackedField packed(field);
+      auto expected = algorithms::soccer_dyn_prog_mod(field, MODULUS);
+      for (size_t threads : {1, 2, 3, 8, 1000}) {
+        EXPECT_EQ(expected, algorithms::soccer_dyn_prog_parallel(packed, threads, MODULUS));
+      }
+    }
+  }
+
+  // exact 64-bit mode, including overflow
+  {
+    std::vector<std::string> field(34, std::string(34, '.'));
+    EXPECT_EQ(7219428434016265740ULL, algorithms::soccer_dyn_prog_parallel(field, 4));
+    std::vector<std::string> wide(40, std::string(600, '.'));
+    EXPECT_THROW(algorithms::soccer_dyn_prog_parallel(wide, 4), std::overflow_error);
+  }
+  for (unsigned x_percent : {30, 40, 50}) {
+    auto field = make_random_field(300, 900, x_percent, rng);
+    auto exact = algorithms::soccer_dyn_prog_exact(field);
+    if (exact.fits_u64() && exact.to_u64() != UINT64_MAX) {
+      EXPECT_EQ(exact.to_u64(), algorithms::soccer_dyn_prog_parallel(field, 3));
+    } else {
+      EXPECT_THROW(algorithms::soccer_dyn_prog_parallel(field, 3), std::overflow_error);
+    }
+  }
+
+  // invalid input
+  EXPECT_THROW(algorithms::soccer_dyn_prog_parallel({"..", "."}), std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_dyn_prog_parallel({".."}, 2, 1), std::invalid_argument);
+}
+
+TEST(soccer_exhaustive_dfs, exhaustive_dfs) {
+
+  // agrees with the candidate loop and the DP on small fields
+  std::mt19937_64 rng(6);
+  for (size_t r = 1; r <= 8; ++r) {
+    for (size_t c = 1; c <= 9; ++c) {
+      auto field = make_random_field(r, c, 20, rng);
+      int expected = algorithms::soccer_exhaustive(field);
+      EXPECT_EQ(expected, algorithms::soccer_dyn_prog(field));
+      EXPECT_EQ(expected, algorithms::soccer_exhaustive_dfs(field));
+      EXPECT_EQ(expected, algorithms::soccer_exhaustive_dfs(field, 3));
+    }
+  }
+
+  // reaches n = 63, beyond the candidate loop
+  EXPECT_EQ(595665, algorithms::soccer_exhaustive_dfs(make_field(5, 60)));
+  for (unsigned x_percent : {10, 20}) {
+    auto field = make_random_field(6, 59, x_percent, rng);
+    auto expected = algorithms::soccer_dyn_prog_u64(field);
+    EXPECT_EQ(expected, algorithms::soccer_exhaustive_dfs(field));
+    EXPECT_EQ(expected, algorithms::soccer_exhaustive_dfs(field, 4));
+  }
+
+  // all passable, n = 24
+  EXPECT_EQ(2704156, algorithms::soccer_exhaustive_dfs(make_field(13, 13), 2));
+
+  // rejects n > 63
+  EXPECT_NO_THROW(algorithms::soccer_exhaustive_dfs(make_field_n(63)));
+  EXPECT_THROW(algorithms::soccer_exhaustive_dfs(make_field_n(64)), std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_exhaustive_dfs(make_field_n(1000000)), std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_exhaustive_dfs({ }), std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_exhaustive_dfs({"..", "."}), std::invalid_argument);
+}
+
+TEST(soccer_exhaustive_mitm, exhaustive_mitm) {
+
+  // agrees with the candidate loop on small fields, including odd n and
+  // blocked corners
+  std::mt19937_64 rng(7);
+  for (size_t r = 1; r <= 8; ++r) {
+    for (size_t c = 1; c <= 9; ++c) {
+      auto field = make_random_field(r, c, 25, rng);
+      EXPECT_EQ(algorithms::soccer_exhaustive(field),
+                algorithms::soccer_exhaustive_mitm(field));
+    }
+  }
+  EXPECT_EQ(0, algorithms::soccer_exhaustive_mitm({"..", ".X"}));
+  EXPECT_EQ(0, algorithms::soccer_exhaustive_mitm({"X.", ".."}));
+  EXPECT_EQ(1, algorithms::soccer_exhaustive_mitm({"."}));
+
+  // reaches n = 64
+  EXPECT_EQ(64, algorithms::soccer_exhaustive_mitm(make_field(2, 64)));
+  EXPECT_EQ(2704156, algorithms::soccer_exhaustive_mitm(make_field(13, 13)));
+  for (unsigned x_percent : {10, 15}) {
+    auto field = make_random_field(31, 35, x_percent, rng);
+    field[0][0] = field[30][34] = '.';
+    EXPECT_EQ(algorithms::soccer_dyn_prog_u64(field),
+              algorithms::soccer_exhaustive_mitm(field));
+  }
+
+  // rejects n > 64
+  EXPECT_NO_THROW(algorithms::soccer_exhaustive_mitm(make_field_n(64)));
+  EXPECT_THROW(algorithms::soccer_exhaustive_mitm(make_field_n(65)), std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_exhaustive_mitm({ }), std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_exhaustive_mitm({"..", "."}), std::invalid_argument);
+}
+
+TEST(soccer_exhaustive_bit_sliced, bit_sliced) {
+
+  // Every block width the CPU supports counts the same candidates as the
+  // depth-first search, including n below the block width (masked lanes),
+  // single rows and columns, and blocked corners.
+  std::mt19937_64 rng(8);
+  std::vector<size_t> widths;
+  for (size_t lanes : {64, 256, 512}) {
+    if (lanes <= algorithms::detail::candidate_lanes()) {
+      widths.push_back(lanes);
+    }
+  }
+  for (size_t r = 1; r <= 12; ++r) {
+    for (size_t c = 1; c + r <= 17; ++c) {
+      for (unsigned x_percent : {0, 15, 35}) {
+        algorithms::PackedField field(make_random_field(r, c, x_percent, rng));
+        auto expected = algorithms::soccer_exhaustive_dfs(field);
+        for (size_t lanes : widths) {
+          EXPECT_EQ(expected, algorithms::detail::count_candidates(field, lanes));
+        }
+      }
+    }
+  }
+
+  // n = 26, so that there are many blocks per field
+  for (unsigned x_percent : {0, 15}) {
+    auto field = make_random_field(12, 16, x_percent, rng);
+    field[0][0] = field[11][15] = '.';
+    algorithms::PackedField packed(field);
+    auto expected = algorithms::soccer_dyn_prog_u64(field);
+    EXPECT_EQ(static_cast<int>(expected), algorithms::soccer_exhaustive(field));
+    EXPECT_EQ(expected, algorithms::detail::count_candidates(packed, 64));
+  }
+
+  // unsupported widths
+  algorithms::PackedField small(make_field(3, 3));
+  EXPECT_THROW(algorithms::detail::count_candidates(small, 128), std::invalid_argument);
+  EXPECT_THROW(algorithms::detail::count_candidates(small, 1024), std::invalid_argument);
+}
+
+TEST(soccer_dyn_prog_batch, batch) {
+
+  // Each slot matches the single-field result modes, and invalid or
+  // overflowing fields only affect their own slots.
+  std::mt19937_64 rng(9);
+  const std::uint64_t MODULUS = 1000000007;
+  std::vector<std::vector<std::string>> fields;
+  for (size_t k = 0; k < 3000; ++k) {
+    fields.push_back(make_random_field(1 + rng() % 12, 1 + rng() % 24, rng() % 30, rng));
+  }
+  fields[7] = { };
+  fields[100] = {"..", "."};
+  fields[2000] = {"..", ".o"};
+  fields[2500] = make_field(40, 40);  // C(78, 39) does not fit in 64 bits
+
+  std::vector<algorithms::BatchCount> out, out_mod;
+  EXPECT_EQ(2996, algorithms::soccer_dyn_prog_batch(fields, out));
+  EXPECT_EQ(2997, algorithms::soccer_dyn_prog_batch(fields, out_mod, MODULUS));
+  ASSERT_EQ(fields.size(), out.size());
+  ASSERT_EQ(fields.size(), out_mod.size());
+  for (size_t k = 0; k < fields.size(); ++k) {
+    if (k == 7 || k == 100 || k == 2000) {
+      EXPECT_EQ(algorithms::BatchStatus::invalid, out[k].status);
+      EXPECT_EQ(algorithms::BatchStatus::invalid, out_mod[k].status);
+    } else if (k == 2500) {
+      EXPECT_EQ(algorithms::BatchStatus::overflow, out[k].status);
+      EXPECT_EQ(algorithms::BatchStatus::ok, out_mod[k].status);
+      EXPECT_EQ(algorithms::soccer_dyn_prog_mod(fields[k], MODULUS), out_mod[k].count);
+    } else {
+      EXPECT_EQ(algorithms::BatchStatus::ok, out[k].status);
+      EXPECT_EQ(algorithms::soccer_dyn_prog_u64(fields[k]), out[k].count);
+      EXPECT_EQ(algorithms::soccer_dyn_prog_mod(fields[k], MODULUS), out_mod[k].count);
+    }
+  }
+
+  // a sub-range, solved on the calling thread
+  algorithms::BatchCount few[3];
+  EXPECT_EQ(2, algorithms::soccer_dyn_prog_batch(&fields[99], 3, few));
+  EXPECT_EQ(out[99].count, few[0].count);
+  EXPECT_EQ(algorithms::BatchStatus::invalid, few[1].status);
+  EXPECT_EQ(out[101].count, few[2].count);
+
+  EXPECT_EQ(0, algorithms::soccer_dyn_prog_batch(nullptr, 0, nullptr));
+  EXPECT_THROW(algorithms::soccer_dyn_prog_batch(fields, out, 1), std::invalid_argument);
+}
+
+TEST(incremental_soccer_solver, incremental) {
+
+  // Replay random edits, checking the count against a fresh solve after
+  // every one. The fields span several tiles in both directions, and the
+  // edits are biased towards the bottom-right corner.
+  std::mt19937_64 rng(10);
+  const std::uint64_t MODULUS = 1000000007;
+  for (auto shape : {std::make_pair(1, 1), std::make_pair(9, 13),
+                     std::make_pair(150, 600), std::make_pair(700, 90)}) {
+    const size_t r = shape.first, c = shape.second;
+    auto field = make_random_field(r, c, 10, rng);
+    field[0][0] = '.';
+    algorithms::IncrementalSoccerSolver solver(field, MODULUS);
+    EXPECT_EQ(algorithms::soccer_dyn_prog_mod(field, MODULUS), solver.count());
+    for (size_t edit = 0; edit < 300; ++edit) {
+      size_t i = rng() % r, j = rng() % c;
+      if (edit % 2) {
+        i = r - 1 - i / 8;
+        j = c - 1 - j / 8;
+      }
+      bool blocked = (rng() % 4) == 0;
+      field[i][j] = blocked ? 'X' : '.';
+      solver.set_cell(i, j, blocked);
+      if (edit % 3 == 0) {
+        continue;  // let edits pile up between counts
+      }
+      ASSERT_EQ(algorithms::soccer_dyn_prog_mod(field, MODULUS), solver.count());
+    }
+    EXPECT_EQ(algorithms::soccer_dyn_prog_mod(field, MODULUS), solver.count());
+  }
+
+  // exact counts, small enough for soccer_dyn_prog itself
+  auto field = make_random_field(20, 20, 15, rng);
+  algorithms::IncrementalSoccerSolver exact(field);
+  for (size_t edit = 0; edit < 200; ++edit) {
+    size_t i = rng() % 20, j = rng() % 20;
+    bool blocked = (rng() % 3) == 0;
+    field[i][j] = blocked ? 'X' : '.';
+    exact.set_cell(i, j, blocked);
+    ASSERT_EQ(algorithms::soccer_dyn_prog(field), static_cast<int>(exact.count()));
+  }
+
+  // overflow is reported by count, and clears when the field closes up
+  algorithms::IncrementalSoccerSolver open_field(make_field(40, 40));
+  EXPECT_THROW(open_field.count(), std::overflow_error);
+  for (size_t j = 0; j < 39; ++j) {
+    open_field.set_cell(1, j, true);
+  }
+  EXPECT_EQ(1, open_field.count());
+
+  EXPECT_THROW(exact.set_cell(20, 0, true), std::invalid_argument);
+  EXPECT_THROW(algorithms::IncrementalSoccerSolver({ }), std::invalid_argument);
+  EXPECT_THROW(algorithms::IncrementalSoccerSolver(make_field(2, 2), 1), std::invalid_argument);
+}
+
+TEST(path_count_tables, path_count_tables) {
+
+  // what-if queries agree with re-solving the field with one more 'X', on
+  // widths on both sides of the 64-bit word boundaries
+  std::mt19937_64 rng(11);
+  const std::uint64_t MODULUS = 1000000007;
+  for (auto shape : {std::make_pair(1, 1), std::make_pair(6, 9), std::make_pair(5, 63),
+                     std::make_pair(4, 64), std::make_pair(3, 65), std::make_pair(2, 130),
+                     std::make_pair(70, 3)}) {
+    const size_t r = shape.first, c = shape.second;
+    auto field = make_random_field(r, c, 15, rng);
+    field[0][0] = '.';
+    algorithms::PathCountTables exact(field), residues(field, MODULUS);
+    EXPECT_EQ(algorithms::soccer_dyn_prog_u64(field), exact.count());
+    EXPECT_EQ(algorithms::soccer_dyn_prog_mod(field, MODULUS), residues.count());
+    for (size_t i = 0; i < r; ++i) {
+      for (size_t j = 0; j < c; ++j) {
+        auto blocked = field;
+        blocked[i][j] = 'X';
+        auto expected = algorithms::soccer_dyn_prog_u64(blocked);
+        ASSERT_EQ(expected, exact.count_if_blocked(i, j));
+        ASSERT_EQ(exact.count() - expected, exact.through(i, j));
+        ASSERT_EQ(expected % MODULUS, residues.count_if_blocked(i, j));
+      }
+    }
+  }
+
+  // counts too large for 64 bits are still right modulo a prime
+  auto large = make_field(100, 100);
+  algorithms::PathCountTables residues(large, MODULUS);
+  EXPECT_EQ(690285631, residues.count());
+  large[50][49] = 'X';
+  EXPECT_EQ(algorithms::soccer_dyn_prog_mod(large, MODULUS),
+            residues.count_if_blocked(50, 49));
+  EXPECT_THROW(algorithms::PathCountTables(make_field(100, 100)), std::overflow_error);
+
+  // the most critical cells, against a full sort of every cell
+  auto field = make_random_field(40, 45, 20, rng);
+  field[0][0] = field[39][44] = '.';
+  algorithms::PathCountTables tables(field);
+  std::vector<algorithms::CriticalCell> all;
+  for (size_t i = 0; i < 40; ++i) {
+    for (size_t j = 0; j < 45; ++j) {
+      if (tables.through(i, j) != 0) {
+        all.push_back({i, j, tables.through(i, j)});
+      }
+    }
+  }
+  std::stable_sort(all.begin(), all.end(), [](const algorithms::CriticalCell& a,
+                                              const algorithms::CriticalCell& b) {
+    return a.through > b.through;
+  });
+  for (size_t k : {size_t{0}, size_t{1}, size_t{7}, size_t{50}, all.size() + 10}) {
+    auto top = tables.critical_cells(k);
+    ASSERT_EQ(std::min(k, all.size()), top.size());
+    for (size_t n = 0; n < top.size(); ++n) {
+      EXPECT_EQ(all[n].row, top[n].row);
+      EXPECT_EQ(all[n].column, top[n].column);
+      EXPECT_EQ(all[n].through, top[n].through);
+    }
+  }
+  // the start cell carries every route
+  ASSERT_FALSE(all.empty());
+  EXPECT_EQ(0, tables.critical_cells(1)[0].row);
+  EXPECT_EQ(tables.count(), tables.critical_cells(1)[0].through);
+
+  EXPECT_THROW(tables.through(40, 0), std::invalid_argument);
+  EXPECT_THROW(tables.count_if_blocked(0, 45), std::invalid_argument);
+  EXPECT_THROW(residues.critical_cells(3), std::invalid_argument);
+  EXPECT_THROW(algorithms::PathCountTables({ }), std::invalid_argument);
+}
+
+// Write text to a file in the test temporary directory and return its path.
+std::string write_temp_file(const std::string& name, const std::string& text) {
+  std::string path = ::testing::TempDir() + name;
+  std::ofstream out(path, std::ios::binary);
+  out << text;
+  return path;
+}
+
+// The text file layout of field, one row per line.
+std::string field_text(const std::vector<std::string>& field,
+                       const std::string& newline = "\n") {
+  std::string text;
+  for (auto& row : field) {
+    text += row + newline;
+  }
+  return text;
+}
+
+TEST(soccer_dyn_prog_file, file) {
+
+  // agrees with the in-memory solvers, with either line ending and with or
+  // without the last newline
+  std::mt19937_64 rng(12);
+  const std::uint64_t MODULUS = 1000000007;
+  for (auto shape : {std::make_pair(1, 1), std::make_pair(7, 3), std::make_pair(40, 130),
+                     std::make_pair(300, 64), std::make_pair(3, 1000)}) {
+    auto field = make_random_field(shape.first, shape.second, 10, rng);
+    auto expected = algorithms::soccer_dyn_prog_mod(field, MODULUS);
+    auto path = write_temp_file("field.txt", field_text(field));
+    EXPECT_EQ(expected, algorithms::soccer_dyn_prog_file(path, MODULUS));
+    path = write_temp_file("field.txt", field_text(field, "\r\n"));
+    EXPECT_EQ(expected, algorithms::soccer_dyn_prog_file(path, MODULUS));
+    auto text = field_text(field);
+    path = write_temp_file("field.txt", text.substr(0, text.size() - 1));
+    EXPECT_EQ(expected, algorithms::soccer_dyn_prog_file(path, MODULUS));
+  }
+  auto path = write_temp_file("field.txt", field_text(make_field(33, 33)));
+  EXPECT_EQ(1832624140942590534, algorithms::soccer_dyn_prog_file(path));
+  path = write_temp_file("field.txt", field_text(make_field(40, 40)));
+  EXPECT_THROW(algorithms::soccer_dyn_prog_file(path), std::overflow_error);
+
+  // invalid fields name the offending line
+  auto expect_invalid = [](const std::string& text, const std::string& message) {
+    auto path = write_temp_file("field.txt", text);
+    try {
+      algorithms::soccer_dyn_prog_file(path);
+      ADD_FAILURE() << "no exception for " << message;
+    } catch (std::invalid_argument& e) {
+      EXPECT_EQ(message, e.what());
+    }
+  };
+  expect_invalid("", "Invalid, empty");
+  expect_invalid("\n..\n", "Invalid, empty");
+  expect_invalid("...\n...\n..\n...\n", "Invalid, row less at line 3");
+  expect_invalid("...\n...\n\n", "Invalid, row less at line 3");
+  expect_invalid("...\r\n.X.\r\n..o\r\n", "Invalid, character at line 3");
+  expect_invalid("..\n..\n.. \n", "Invalid, row less at line 3");
+
+  EXPECT_THROW(algorithms::soccer_dyn_prog_file(::testing::TempDir() + "missing.txt"),
+               std::system_error);
+}
+
+// The size of the file at path, in bytes.
+size_t file_size(const std::string& path) {
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  return in.tellg();
+}
+
+TEST(sfld, sfld) {
+
+  // round trips through save_sfld and the text converter, solved from the
+  // packed and the run-length rows alike
+  std::mt19937_64 rng(13);
+  const std::uint64_t MODULUS = 1000000007;
+  auto sfld = ::testing::TempDir() + "field.sfld";
+  for (auto shape : {std::make_pair(1, 1), std::make_pair(7, 3), std::make_pair(40, 130),
+                     std::make_pair(300, 64), std::make_pair(3, 1000)}) {
+    for (unsigned x_percent : {0, 2, 30, 97, 100}) {
+      auto field = make_random_field(shape.first, shape.second, x_percent, rng);
+      algorithms::PackedField packed(field);
+      auto expected = algorithms::soccer_dyn_prog_mod(field, MODULUS);
+
+      algorithms::save_sfld(packed, sfld);
+      EXPECT_EQ(expected, algorithms::soccer_dyn_prog_sfld(sfld, MODULUS));
+      auto loaded = algorithms::load_sfld(sfld);
+      ASSERT_EQ(packed.rows(), loaded.rows());
+      ASSERT_EQ(packed.columns(), loaded.columns());
+      for (size_t i = 0; i < packed.rows(); ++i) {
+        for (size_t j = 0; j < packed.columns(); ++j) {
+          ASSERT_EQ(packed.open(i, j), loaded.open(i, j));
+        }
+      }
+
+      auto saved = file_size(sfld);
+      algorithms::convert_text_to_sfld(write_temp_file("field.txt", field_text(field)), sfld);
+      EXPECT_EQ(saved, file_size(sfld));
+      EXPECT_EQ(expected, algorithms::soccer_dyn_prog_sfld(sfld, MODULUS));
+    }
+  }
+  algorithms::save_sfld(algorithms::PackedField(make_field(33, 33)), sfld);
+  EXPECT_EQ(1832624140942590534, algorithms::soccer_dyn_prog_sfld(sfld));
+
+  // sparse rows shrink to a few bytes, dense ones to one bit per cell
+  algorithms::save_sfld(algorithms::PackedField(make_field(1000, 1000, 'X')), sfld);
+  EXPECT_EQ(0, algorithms::soccer_dyn_prog_sfld(sfld));
+  EXPECT_LE(file_size(sfld), 32 + 1000 * 4);
+  algorithms::save_sfld(algorithms::PackedField(make_random_field(100, 1000, 50, rng)), sfld);
+  EXPECT_EQ(32 + 100 * (1 + 125), file_size(sfld));
+
+  // invalid files
+  auto expect_invalid = [&](const std::string& bytes, const std::string& message) {
+    auto path = write_temp_file("bad.sfld", bytes);
+    try {
+      algorithms::soccer_dyn_prog_sfld(path);
+      ADD_FAILURE() << "no exception for " << message;
+    } catch (std::invalid_argument& e) {
+      EXPECT_EQ(message, e.what());
+    }
+    try {
+      algorithms::load_sfld(path);
+      ADD_FAILURE() << "no exception for " << message;
+    } catch (std::invalid_argument& e) {
+      EXPECT_EQ(message, e.what());
+    }
+  };
+  auto header = [](std::uint64_t rows, std::uint64_t columns) {
+    std::string bytes("SFLD\1\0\0\0", 8);
+    for (std::uint64_t value : { rows, columns, std::uint64_t{0} }) {
+      for (size_t b = 0; b < 8; ++b) {
+        bytes.push_back(static_cast<char>(value >> (8 * b)));
+      }
+    }
+    return bytes;
+  };
+  algorithms::save_sfld(algorithms::PackedField(make_field(3, 70)), sfld);
+  std::ifstream in(sfld, std::ios::binary);
+  std::string good((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  EXPECT_EQ(32 + 3 * 2, good.size());
+  expect_invalid("", "Invalid, not an sfld file");
+  expect_invalid("SFLE" + good.substr(4), "Invalid, not an sfld file");
+  expect_invalid(good.substr(0, 4) + '\2' + good.substr(5), "Invalid, sfld version");
+  algorithms::save_sfld(algorithms::PackedField(make_random_field(3, 70, 50, rng)), sfld);
+  std::ifstream packed_in(sfld, std::ios::binary);
+  std::string packed_rows((std::istreambuf_iterator<char>(packed_in)),
+                          std::istreambuf_iterator<char>());
+  EXPECT_EQ(32 + 3 * (1 + 9), packed_rows.size());
+  expect_invalid(packed_rows.substr(0, packed_rows.size() - 1), "Invalid, truncated at row 3");
+  expect_invalid(good + '\0', "Invalid, sfld size");
+  auto corrupt = good;
+  corrupt[33] = 71;  // the first row's run of 70 '.' becomes longer than the row
+  expect_invalid(corrupt, "Invalid, sfld row at row 1");
+  corrupt = good;
+  corrupt[32] = '\7';
+  expect_invalid(corrupt, "Invalid, sfld row at row 1");
+  corrupt = good;
+  corrupt[31] ^= 1;
+  expect_invalid(corrupt, "Invalid, checksum");
+
+  // headers claiming more rows or columns than the file can hold
+  expect_invalid(header(std::uint64_t{1} << 62, 1) + "\1\1", "Invalid, sfld size");
+  expect_invalid(header(3, 70) + good.substr(32, 4), "Invalid, sfld size");
+  expect_invalid(header(1, std::uint64_t{1} << 40) + "\1\x80\x80\x80\x80\x80\x20",
+                 "Invalid, sfld size");
+  expect_invalid(header(1, ~std::uint64_t{0}) + "\1\0", "Invalid, sfld size");
+
+  // runs that would decode past MAX_EXPANSION are written packed
+  algorithms::PackedField open_row(make_field(1, 100000));
+  algorithms::save_sfld(open_row, sfld);
+  EXPECT_EQ(32 + 1 + 12500, file_size(sfld));
+  EXPECT_EQ(1, algorithms::soccer_dyn_prog_sfld(sfld));
+  auto loaded_row = algorithms::load_sfld(sfld);
+  ASSERT_EQ(100000, loaded_row.columns());
+  EXPECT_TRUE(std::equal(open_row.row(0), open_row.row(0) + (100000 + 63) / 64,
+                         loaded_row.row(0)));
+
+  // a failed conversion leaves the file it would have replaced alone
+  algorithms::save_sfld(algorithms::PackedField(make_field(3, 70)), sfld);
+  EXPECT_THROW(algorithms::convert_text_to_sfld(write_temp_file("field.txt", "..\n.\n"), sfld),
+               std::invalid_argument);
+  EXPECT_EQ(2485, algorithms::soccer_dyn_prog_sfld(sfld));
+
+  // writers to the same file each write their own part file, and the last
+  // to finish wins
+  {
+    std::vector<std::thread> writers;
+    for (size_t k = 1; k <= 4; ++k) {
+      writers.emplace_back([&, k] {
+        algorithms::save_sfld(algorithms::PackedField(make_field(k, 300)), sfld);
+      });
+    }
+    for (auto& writer : writers) {
+      writer.join();
+    }
+    const auto rows = algorithms::load_sfld(sfld).rows();
+    EXPECT_TRUE(rows >= 1 && rows <= 4);
+  }
+  for (const auto& entry : std::filesystem::directory_iterator(::testing::TempDir())) {
+    EXPECT_NE(0, entry.path().filename().string().rfind("field.sfld.part", 0));
+  }
+  EXPECT_THROW(algorithms::load_sfld(::testing::TempDir() + "missing.sfld"), std::system_error);
+}
+
+TEST(field_view, field_view) {
+  std::mt19937_64 rng(14);
+  for (int trial = 0; trial < 20; ++trial) {
+    auto field = make_random_field(1 + rng() % 12, 1 + rng() % 12, 20, rng);
+    auto expected_dyn = algorithms::soccer_dyn_prog(field);
+    auto expected_exh = algorithms::soccer_exhaustive(field);
+    const size_t rows = field.size(), width = field[0].size();
+
+    // a newline terminated buffer, as a text file or mmap region holds it
+    std::string text = field_text(field, "\n");
+    std::string packed;
+    std::vector<std::string_view> views;
+    for (const auto& row : field) {
+      packed += row;
+    }
+    for (size_t i = 0; i < rows; ++i) {
+      views.emplace_back(text.data() + i * (width + 1), width);
+    }
+
+    const algorithms::FieldView wrapped[] = {
+      algorithms::FieldView(field),
+      algorithms::FieldView(text.data(), rows, width, width + 1),
+      algorithms::FieldView(packed.data(), rows, width, width),
+      algorithms::FieldView(views.data(), views.size()),
+    };
+    for (const auto& view : wrapped) {
+      EXPECT_EQ(rows, view.rows());
+      EXPECT_EQ(width, view.columns());
+      EXPECT_EQ(expected_dyn, algorithms::soccer_dyn_prog(view));
+      EXPECT_EQ(expected_exh, algorithms::soccer_exhaustive(view));
+    }
+  }
+
+  // the same validation as for a vector of strings
+  std::vector<std::string_view> ragged = { "...", "..", "..." };
+  EXPECT_THROW(algorithms::soccer_dyn_prog(algorithms::FieldView(ragged.data(), 3)),
+               std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_exhaustive(algorithms::FieldView(ragged.data(), 3)),
+               std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_dyn_prog(algorithms::FieldView("..\n.x\n", 2, 2, 3)),
+               std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_dyn_prog(algorithms::FieldView(nullptr, 0, 0, 0)),
+               std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_exhaustive(algorithms::FieldView(nullptr, 0, 0, 0)),
+               std::invalid_argument);
+  EXPECT_EQ(1, algorithms::soccer_dyn_prog(algorithms::FieldView(".", 1, 1, 1)));
+}
+
+TEST(solve_stats, solve_stats) {
+  // The counters of the plain candidate loop, one candidate at a time.
+  auto reference = [](const std::vector<std::string>& field) {
+    algorithms::SolveStats stats;
+    const size_t rows = field.size(), columns = field[0].size();
+    const size_t n = rows + columns - 2;
+    stats.candidates_generated = uint64_t{1} << n;
+    for (uint64_t candidate = 0; candidate < stats.candidates_generated; ++candidate) {
+      if (field[0][0] == 'X') {
+        ++stats.candidates_killed_by_obstacle;
+        continue;
+      }
+      size_t i = 0, j = 0;
+      for (size_t move = 0; move < n; ++move) {
+        ++stats.prefix_moves;
+        ((candidate >> move) & 1) ? ++j : ++i;
+        if (i >= rows || j >= columns) {
+          ++stats.candidates_killed_leaving_grid;
+          break;
+        }
+        if (field[i][j] == 'X') {
+          ++stats.candidates_killed_by_obstacle;
+          break;
+        }
+      }
+    }
+    return stats;
+  };
+
+  std::mt19937_64 rng(18);
+  std::vector<std::vector<std::string>> fields = {
+    make_field(1, 1), make_field(4, 4), make_field(2, 12), make_field(11, 3),
+    { "X.", ".." }, make_field(8, 13),
+  };
+  for (int trial = 0; trial < 12; ++trial) {
+    fields.push_back(make_random_field(1 + rng() % 9, 1 + rng() % 12, 15, rng));
+  }
+  for (const auto& field : fields) {
+    algorithms::SolveStats stats;
+    stats.prefix_moves = 12345;  // reset by the call
+    EXPECT_EQ(algorithms::soccer_exhaustive(field),
+              algorithms::soccer_exhaustive(field, stats));
+    if (!algorithms::SolveStats::ENABLED) {
+      EXPECT_EQ(0, stats.candidates_generated);
+      EXPECT_EQ(0, stats.prefix_moves);
+      continue;
+    }
+    auto expected = reference(field);
+    auto count = algorithms::soccer_exhaustive(field);
+    EXPECT_EQ(expected.candidates_generated, stats.candidates_generated);
+    EXPECT_EQ(expected.candidates_killed_by_obstacle, stats.candidates_killed_by_obstacle);
+    EXPECT_EQ(expected.candidates_killed_leaving_grid, stats.candidates_killed_leaving_grid);
+    EXPECT_EQ(expected.prefix_moves, stats.prefix_moves);
+    EXPECT_EQ(stats.candidates_generated, count + stats.candidates_killed_by_obstacle
+                                          + stats.candidates_killed_leaving_grid);
+    EXPECT_EQ(0, stats.cells_visited);
+  }
+
+  // every block width counts the same
+  if (algorithms::SolveStats::ENABLED) {
+    auto field = make_random_field(10, 14, 10, rng);
+    algorithms::PackedField packed(field);
+    auto expected = reference(field);
+    for (size_t lanes : { 64, 256, 512 }) {
+      if (lanes > algorithms::detail::candidate_lanes()) {
+        continue;
+      }
+      algorithms::SolveStats stats;
+      algorithms::detail::count_candidates(packed, lanes, stats);
+      EXPECT_EQ(expected.candidates_killed_by_obstacle, stats.candidates_killed_by_obstacle);
+      EXPECT_EQ(expected.candidates_killed_leaving_grid, stats.candidates_killed_leaving_grid);
+      EXPECT_EQ(expected.prefix_moves, stats.prefix_moves);
+    }
+  }
+
+  // without obstacles the DP sweeps every cell, tall fields by row and wide
+  // ones by column
+  for (auto shape : { std::make_pair(300, 70), std::make_pair(70, 300) }) {
+    auto field = make_random_field(shape.first, shape.second, 0, rng);
+    size_t blocked = 0;
+    for (auto& row : field) {
+      blocked += std::count(row.begin(), row.end(), 'X');
+    }
+    algorithms::SolveStats stats;
+    EXPECT_EQ(algorithms::soccer_dyn_prog(field), algorithms::soccer_dyn_prog(field, stats));
+    if (algorithms::SolveStats::ENABLED) {
+      EXPECT_EQ(300 * 70, stats.cells_visited);
+      EXPECT_EQ(blocked, stats.obstacle_cells_skipped);
+      // the packed field, 70 counts of frontier, and for the wide field
+      // one 64 line strip
+      const size_t packed = ((shape.second + 255) / 256) * 32 * shape.first;
+      EXPECT_GE(stats.peak_workspace_bytes, packed + 70 * 8);
+      EXPECT_LE(stats.peak_workspace_bytes, packed + 70 * 8 + 64 * 32);
+      EXPECT_EQ(0, stats.candidates_generated);
+    } else {
+      EXPECT_EQ(0, stats.cells_visited);
+      EXPECT_EQ(0, stats.peak_workspace_bytes);
+    }
+  }
+
+  // with them it skips the cells outside the route spans, here the end of
+  // the first row, but the word of the second holding (1, 0) is swept
+  if (algorithms::SolveStats::ENABLED) {
+    auto field = make_field(300, 70);
+    field[0][5] = field[1][0] = 'X';
+    algorithms::SolveStats stats;
+    algorithms::soccer_dyn_prog(field, stats);
+    EXPECT_EQ(5 + 299 * 70, stats.cells_visited);
+    EXPECT_EQ(1, stats.obstacle_cells_skipped);
+  }
+}
+
+TEST(fixed_shape, fixed_shape) {
+  // solved at compile time
+  constexpr auto small = algorithms::make_fixed_field<2, 3>({ "...", ".X." });
+  static_assert(algorithms::soccer_dyn_prog_fixed(small) == 1);
+  constexpr auto open = algorithms::make_fixed_field<8, 9>({
+    ".........", ".........", ".........", ".........",
+    ".........", ".........", ".........", ".........",
+  });
+  static_assert(algorithms::soccer_dyn_prog_fixed(open) == 6435);  // C(15, 7)
+  static_assert(algorithms::soccer_dyn_prog_fixed<8, 9, std::uint8_t>(open) == 6435 % 256);
+  constexpr algorithms::FixedField<16, 24> wide = [] {
+    algorithms::FixedField<16, 24> field{};
+    for (size_t i = 0; i < 16; ++i) {
+      for (size_t j = 0; j < 24; ++j) {
+        field[i][j] = '.';
+      }
+    }
+    return field;
+  }();
+  static_assert(algorithms::soccer_dyn_prog_fixed(wide) == 15471286560ULL);  // C(38, 15)
+  EXPECT_THROW((algorithms::make_fixed_field<2, 3>({ "...", ".." })), std::invalid_argument);
+  EXPECT_THROW((algorithms::make_fixed_field<2, 3>({ "...", "...." })), std::invalid_argument);
+
+  std::mt19937_64 rng(19);
+  for (auto shape : { std::make_pair(8, 9), std::make_pair(9, 8),
+                      std::make_pair(16, 24), std::make_pair(24, 16),
+                      std::make_pair(7, 9), std::make_pair(40, 3) }) {
+    for (int trial = 0; trial < 10; ++trial) {
+      auto field = make_random_field(shape.first, shape.second, 10, rng);
+      EXPECT_EQ(algorithms::soccer_dyn_prog(field), algorithms::soccer_dyn_prog_shaped(field));
+    }
+  }
+  // counts past 2^32 keep the low 32 bits, as soccer_dyn_prog
+  auto field = make_field(16, 24);
+  EXPECT_EQ(algorithms::soccer_dyn_prog(field), algorithms::soccer_dyn_prog_shaped(field));
+
+  EXPECT_THROW(algorithms::soccer_dyn_prog_shaped({}), std::invalid_argument);
+  field = make_field(8, 9);
+  field[3] = "........";
+  EXPECT_THROW(algorithms::soccer_dyn_prog_shaped(field), std::invalid_argument);
+  field[3] = "....x....";
+  EXPECT_THROW(algorithms::soccer_dyn_prog_shaped(field), std::invalid_argument);
+}
+
+TEST(soccer_sparse, sparse) {
+  const uint64_t PRIME = 1000000007;
+  std::mt19937_64 rng(20);
+
+  // The field of an obstacle list.
+  auto to_field = [](size_t rows, size_t columns,
+                     const std::vector<algorithms::FieldCell>& obstacles) {
+    auto field = make_field(rows, columns);
+    for (auto& cell : obstacles) {
+      field[cell.row][cell.column] = 'X';
+    }
+    return field;
+  };
+
+  for (int trial = 0; trial < 40; ++trial) {
+    size_t rows = 1 + rng() % 60, columns = 1 + rng() % 60;
+    std::vector<algorithms::FieldCell> obstacles;
+    for (size_t k = rng() % 40; k > 0; --k) {
+      obstacles.push_back({ rng() % rows, rng() % columns });
+    }
+    auto field = to_field(rows, columns, obstacles);
+    EXPECT_EQ(algorithms::soccer_dyn_prog_mod(field, PRIME),
+              algorithms::soccer_sparse(rows, columns, obstacles, PRIME));
+    EXPECT_EQ(algorithms::soccer_dyn_prog_mod(field, PRIME),
+              algorithms::soccer_count_obstacles(rows, columns, obstacles, PRIME));
+    auto exact = algorithms::soccer_dyn_prog_exact(field);
+    EXPECT_EQ(exact.to_string(), algorithms::soccer_sparse_exact(rows, columns, obstacles).to_string());
+    if (exact.fits_u64()) {
+      EXPECT_EQ(exact.to_u64(), algorithms::soccer_sparse(rows, columns, obstacles));
+      EXPECT_EQ(exact.to_u64(), algorithms::soccer_count_obstacles(rows, columns, obstacles));
+    } else {
+      EXPECT_THROW(algorithms::soccer_sparse(rows, columns, obstacles), std::overflow_error);
+    }
+  }
+
+  EXPECT_EQ(1832624140942590534, algorithms::soccer_sparse(33, 33, {}));
+  EXPECT_EQ(7219428434016265740ULL, algorithms::soccer_sparse(34, 34, {}));
+  EXPECT_THROW(algorithms::soccer_sparse(35, 35, {}), std::overflow_error);
+  EXPECT_EQ(0, algorithms::soccer_sparse(5, 5, { {0, 0} }));
+  EXPECT_EQ(0, algorithms::soccer_sparse(5, 5, { {4, 4}, {4, 4} }));
+  EXPECT_EQ("0", algorithms::soccer_sparse_exact(5, 5, { {1, 0}, {0, 1} }).to_string());
+  EXPECT_EQ(1, algorithms::soccer_sparse(3, 3, { {1, 1}, {1, 1}, {0, 2} }));
+
+  // a field far too large for the DP
+  std::vector<algorithms::FieldCell> defenders;
+  for (int k = 0; k < 2000; ++k) {
+    defenders.push_back({ 1 + rng() % 999998, 1 + rng() % 999998 });
+  }
+  auto count = algorithms::soccer_count_obstacles(1000000, 1000000, defenders, PRIME);
+  EXPECT_EQ(algorithms::soccer_sparse(1000000, 1000000, defenders, PRIME), count);
+  EXPECT_LT(count, PRIME);
+
+  EXPECT_THROW(algorithms::soccer_sparse(0, 5, {}), std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_sparse(5, 5, { {5, 0} }), std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_sparse(5, 5, {}, 1000000008), std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_sparse(5, 5, {}, 7), std::invalid_argument);
+  EXPECT_EQ(70 % 11, algorithms::soccer_sparse(5, 5, {}, 11));
+  // a modulus the sparse solver cannot use goes to the DP
+  EXPECT_EQ(70 % 12, algorithms::soccer_count_obstacles(5, 5, {}, 12));
+}
+
+TEST(route_spans, route_spans) {
+  // The count modulo PRIME, one cell at a time.
+  const uint64_t PRIME = 1000000007;
+  auto reference = [&](const std::vector<std::string>& field) {
+    std::vector<uint64_t> line(field[0].size(), 0);
+    line[0] = 1;
+    for (const auto& row : field) {
+      for (size_t j = 0; j < row.size(); ++j) {
+        line[j] = (row[j] == 'X') ? 0 : (line[j] + (j > 0 ? line[j - 1] : 0)) % PRIME;
+      }
+    }
+    return line.back();
+  };
+
+  // near the percolation threshold many fields have no route at all, and
+  // the others only narrow bands of cells on routes
+  std::mt19937_64 rng(21);
+  for (auto shape : { std::make_pair(64, 64), std::make_pair(200, 90),
+                      std::make_pair(90, 200), std::make_pair(65, 300),
+                      std::make_pair(130, 129), std::make_pair(5, 70) }) {
+    for (unsigned x_percent : { 10, 30, 40, 45 }) {
+      auto field = make_random_field(shape.first, shape.second, x_percent, rng);
+      EXPECT_EQ(reference(field), algorithms::soccer_dyn_prog_mod(field, PRIME));
+    }
+  }
+
+  // a staircase corridor through a field of X has one route, and each line
+  // spans its stair and the step down from it
+  const size_t n = 150;
+  auto stairs = make_field(n, n, 'X');
+  for (size_t i = 0; i < n; ++i) {
+    stairs[i][i] = '.';
+    if (i + 1 < n) {
+      stairs[i][i + 1] = '.';
+    }
+  }
+  stairs[0][0] = '.';
+  EXPECT_EQ(1, algorithms::soccer_dyn_prog(stairs));
+  algorithms::PackedField packed(stairs);
+  algorithms::detail::LineSource source(packed);
+  algorithms::detail::RouteSpans spans(source);
+  ASSERT_TRUE(spans.route());
+  for (size_t a = 0; a < n; ++a) {
+    EXPECT_EQ(a, spans.lo(a));
+    EXPECT_EQ(std::min(a + 1, n - 1), spans.hi(a));
+  }
+
+  // no route: the goal is walled in, the start is walled in, or a line in
+  // between is all X; open cells off every route do not matter
+  auto walled = make_field(100, 120);
+  walled[98][119] = walled[99][118] = 'X';
+  auto trapped = make_field(120, 100);
+  trapped[0][1] = trapped[1][0] = 'X';
+  auto wall = make_field(80, 200);
+  for (size_t i = 0; i < 80; ++i) {
+    wall[i][150] = 'X';
+  }
+  for (const auto& field : { walled, trapped, wall }) {
+    EXPECT_EQ(0, algorithms::soccer_dyn_prog(field));
+    EXPECT_EQ("0", algorithms::soccer_dyn_prog_exact(field).to_string());
+    algorithms::PackedField packed(field);
+    algorithms::detail::LineSource source(packed);
+    EXPECT_FALSE(algorithms::detail::RouteSpans(source).route());
+  }
+
+  // lines read in any order
+  auto wide = make_random_field(70, 300, 20, rng);
+  algorithms::PackedField wide_packed(wide);
+  algorithms::detail::LineSource columns(wide_packed);
+  for (size_t a : { 299, 3, 130, 64, 63, 0, 299 }) {
+    const uint64_t* line = columns.line(a);
+    for (size_t i = 0; i < 70; ++i) {
+      EXPECT_EQ(wide[i][a] == '.', ((line[i / 64] >> (i % 64)) & 1) != 0);
+    }
+  }
+}
+
+TEST(solve_cache, solve_cache) {
+  std::mt19937_64 rng(22);
+
+  // the same key for every form of a field, another for any other field,
+  // including the same bits in another shape
+  auto field = make_random_field(10, 20, 20, rng);
+  algorithms::PackedField packed(field);
+  const std::string text = field_text(field, "\n");
+  const auto key = algorithms::field_hash(packed);
+  EXPECT_TRUE(key == algorithms::field_hash(field));
+  EXPECT_TRUE(key == algorithms::field_hash(algorithms::FieldView(text.data(), 10, 20, 21)));
+  auto flipped = packed;
+  flipped.set_open(9, 7, !flipped.open(9, 7));
+  EXPECT_FALSE(key == algorithms::field_hash(flipped));
+  EXPECT_FALSE(algorithms::field_hash(make_field(1, 128)) ==
+               algorithms::field_hash(make_field(2, 64)));
+  auto wide = make_random_field(3, 9000, 10, rng);
+  EXPECT_TRUE(algorithms::field_hash(wide) ==
+              algorithms::field_hash(algorithms::PackedField(wide)));
+
+  // row words equal to the lanes' constants keep the rows before them
+  auto word_row = [](std::uint64_t word) {
+    std::string row;
+    for (size_t j = 0; j < 64; ++j) {
+      row += ((word >> j) & 1) ? '.' : 'X';
+    }
+    return row;
+  };
+  std::vector<std::string> open_start = { std::string(64, '.'),
+                                          word_row(0xBF58476D1CE4E5B9ULL),
+                                          word_row(0xC2B2AE3D27D4EB4FULL),
+                                          std::string(64, '.') };
+  auto narrow_start = open_start;
+  narrow_start[0] = std::string(10, '.') + std::string(54, 'X');
+  EXPECT_FALSE(algorithms::field_hash(open_start) == algorithms::field_hash(narrow_start));
+  algorithms::SolveCache lanes;
+  EXPECT_EQ(74, lanes.soccer_dyn_prog(open_start));
+  EXPECT_EQ(9, lanes.soccer_dyn_prog(narrow_start));
+
+  algorithms::SolveCache cache;
+  const int expected = algorithms::soccer_dyn_prog(field);
+  EXPECT_EQ(expected, cache.soccer_dyn_prog(field));
+  EXPECT_EQ(expected, cache.soccer_dyn_prog(packed));
+  EXPECT_EQ(expected, cache.soccer_dyn_prog(algorithms::FieldView(text.data(), 10, 20, 21)));
+  auto counters = cache.counters();
+  EXPECT_EQ(1, counters.misses);
+  EXPECT_EQ(2, counters.hits);
+  EXPECT_EQ(1, counters.entries);
+  EXPECT_EQ(size_t{algorithms::SolveCache::ENTRY_BYTES}, counters.bytes);
+
+  // invalid fields throw as soccer_dyn_prog does, and are not cached
+  EXPECT_THROW(cache.soccer_dyn_prog(std::vector<std::string>{}), std::invalid_argument);
+  EXPECT_THROW(cache.soccer_dyn_prog({ "..", "." }), std::invalid_argument);
+  EXPECT_THROW(cache.soccer_dyn_prog({ "..", ".Y" }), std::invalid_argument);
+  EXPECT_EQ(1, cache.counters().entries);
+  cache.clear();
+  EXPECT_EQ(0, cache.counters().entries);
+  EXPECT_EQ(2, cache.counters().hits);
+
+  // two entries per shard: a hit keeps an entry over a newer one
+  const size_t SHARDS = algorithms::SolveCache::SHARDS;
+  algorithms::SolveCache small(SHARDS * algorithms::SolveCache::ENTRY_BYTES * 2);
+  std::vector<std::vector<std::string>> same_shard;
+  while (same_shard.size() < 3) {
+    auto candidate = make_random_field(8, 8, 20, rng);
+    if (algorithms::field_hash(candidate).high % SHARDS == key.high % SHARDS) {
+      same_shard.push_back(candidate);
+    }
+  }
+  small.soccer_dyn_prog(same_shard[0]);
+  small.soccer_dyn_prog(same_shard[1]);
+  small.soccer_dyn_prog(same_shard[0]);
+  small.soccer_dyn_prog(same_shard[2]);
+  EXPECT_EQ(1, small.counters().evictions);
+  small.soccer_dyn_prog(same_shard[0]);
+  EXPECT_EQ(2, small.counters().hits);
+  small.soccer_dyn_prog(same_shard[1]);
+  EXPECT_EQ(4, small.counters().misses);
+
+  // the memory cap holds however many fields pass through
+  for (int k = 0; k < 300; ++k) {
+    small.soccer_dyn_prog(make_random_field(6, 7, 25, rng));
+  }
+  counters = small.counters();
+  EXPECT_LE(counters.bytes, small.max_bytes());
+  EXPECT_EQ(counters.misses, counters.entries + counters.evictions);
+
+  // threads share one cache
+  std::vector<std::vector<std::string>> fields;
+  std::vector<int> counts;
+  for (int k = 0; k < 40; ++k) {
+    fields.push_back(make_random_field(1 + rng() % 30, 1 + rng() % 30, 15, rng));
+    counts.push_back(algorithms::soccer_dyn_prog(fields.back()));
+  }
+  algorithms::SolveCache shared;
+  std::vector<std::thread> threads;
+  std::vector<int> wrong(4, 0);
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t] {
+      for (int round = 0; round < 50; ++round) {
+        for (size_t k = 0; k < fields.size(); ++k) {
+          size_t f = (k * 7 + t + round) % fields.size();
+          wrong[t] += (shared.soccer_dyn_prog(fields[f]) != counts[f]);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(std::vector<int>(4, 0), wrong);
+  counters = shared.counters();
+  EXPECT_EQ(4 * 50 * fields.size(), counters.hits + counters.misses);
+  EXPECT_EQ(fields.size(), counters.entries);
+}
+
+TEST(soccer_repeated, repeated) {
+  const uint64_t PRIME = 1000000007;
+  auto expand = [](const std::vector<algorithms::RowBlock>& blocks) {
+    std::vector<std::string> field;
+    for (const auto& block : blocks) {
+      for (uint64_t k = 0; k < block.repetitions; ++k) {
+        field.insert(field.end(), block.rows.begin(), block.rows.end());
+      }
+    }
+    return field;
+  };
+
+  // narrow fields take the transfer matrices, wide ones sweep their rows
+  std::mt19937_64 rng(23);
+  for (size_t width : { 1, 2, 3, 6, 17, 70 }) {
+    for (int trial = 0; trial < 4; ++trial) {
+      std::vector<algorithms::RowBlock> blocks;
+      for (int b = 0; b < 3; ++b) {
+        auto rows = make_random_field(1 + rng() % 4, width, 15, rng);
+        for (auto& row : rows) {
+          row[0] = row[width - 1] = '.';
+        }
+        blocks.push_back({ rows, 1 + rng() % 400 });
+      }
+      blocks.push_back({ { std::string(width, '.') }, 0 });
+      auto field = expand(blocks);
+      EXPECT_EQ(algorithms::soccer_dyn_prog_parallel(field, 1, PRIME),
+                algorithms::soccer_repeated(blocks, PRIME));
+      EXPECT_EQ(algorithms::soccer_dyn_prog_parallel(field, 1, PRIME),
+                algorithms::soccer_dyn_prog_periodic(field, PRIME));
+      if (width <= 3) {
+        auto exact = algorithms::soccer_dyn_prog_exact(field);
+        if (exact.fits_u64()) {
+          EXPECT_EQ(exact.to_u64(), algorithms::soccer_repeated(blocks));
+        } else {
+          EXPECT_THROW(algorithms::soccer_repeated(blocks), std::overflow_error);
+        }
+      }
+    }
+  }
+
+  // 10^12 open rows: C(n + c - 2, c - 1) routes for c columns
+  const uint64_t n = 1000000000000;
+  EXPECT_EQ(n, algorithms::soccer_repeated({ { { ".." }, n } }));
+  EXPECT_THROW(algorithms::soccer_repeated({ { { "..." }, n } }), std::overflow_error);
+  const unsigned __int128 triangle = (unsigned __int128)(n + 1) * n / 2;
+  EXPECT_EQ(uint64_t(triangle % PRIME),
+            algorithms::soccer_repeated({ { { "...", "..." }, n / 2 } }, PRIME));
+  // a row open only at the last column funnels every route into it, so
+  // only the first block branches
+  EXPECT_EQ(4, algorithms::soccer_repeated({ { { "....", "....", "XXX." }, n } }));
+  EXPECT_EQ(2, algorithms::soccer_repeated({ { { "....", ".XX.", "....", "XXX." }, n },
+                                             { { "...." }, 3 } }));
+  EXPECT_EQ(0, algorithms::soccer_repeated({ { { "....", "XXXX" }, n } }, PRIME));
+
+  // runs of repeated blocks, and the rows between them
+  const std::string A = "..X", B = "...", C = ".X.", D = "X..", E = "XX.";
+  std::vector<std::string> field = { A, B, B, B, C, D, C, D, C, D, E, A, A };
+  auto blocks = algorithms::find_row_blocks(field);
+  ASSERT_EQ(5, blocks.size());
+  EXPECT_EQ(std::vector<std::string>({ A }), blocks[0].rows);
+  EXPECT_EQ(1, blocks[0].repetitions);
+  EXPECT_EQ(std::vector<std::string>({ B }), blocks[1].rows);
+  EXPECT_EQ(3, blocks[1].repetitions);
+  EXPECT_EQ(std::vector<std::string>({ C, D }), blocks[2].rows);
+  EXPECT_EQ(3, blocks[2].repetitions);
+  EXPECT_EQ(std::vector<std::string>({ E }), blocks[3].rows);
+  EXPECT_EQ(1, blocks[3].repetitions);
+  EXPECT_EQ(std::vector<std::string>({ A }), blocks[4].rows);
+  EXPECT_EQ(2, blocks[4].repetitions);
+  EXPECT_EQ(field, expand(blocks));
+
+  EXPECT_THROW(algorithms::soccer_repeated({}), std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_repeated({ { { ".." }, 0 } }), std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_repeated({ { { ".." }, 2 }, { { "..." }, 2 } }),
+               std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_repeated({ { { ".." }, 2 }, { { ".Y" }, 0 } }),
+               std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_repeated({ { { ".." }, 2 } }, 1), std::invalid_argument);
+  EXPECT_THROW(algorithms::soccer_dyn_prog_periodic({}), std::invalid_argument);
+}
+
+TEST(path_ranks, path_ranks) {
+  // every move string that stays on passable cells, in rank order
+  auto all_routes = [](const std::vector<std::string>& field) {
+    const size_t rows = field.size(), columns = field[0].size(), n = rows + columns - 2;
+    std::vector<std::string> routes;
+    for (uint64_t candidate = 0; candidate < (uint64_t{1} << n); ++candidate) {
+      std::string path;
+      size_t i = 0, j = 0;
+      bool valid = field[0][0] == '.';
+      for (size_t move = 0; move < n && valid; ++move) {
+        ((candidate >> move) & 1) ? ++j : ++i;
+        path.push_back(((candidate >> move) & 1) ? '>' : 'v');
+        valid = i < rows && j < columns && field[i][j] == '.';
+      }
+      if (valid) {
+        routes.push_back(path);
+      }
+    }
+    // 'v' before '>', unlike ASCII
+    std::sort(routes.begin(), routes.end(), [](std::string a, std::string b) {
+      std::replace(a.begin(), a.end(), 'v', '0');
+      std::replace(b.begin(), b.end(), 'v', '0');
+      return a < b;
+    });
+    return routes;
+  };
+
+  std::mt19937_64 rng(24);
+  std::vector<std::vector<std::string>> fields = {
+    make_field(1, 1), make_field(1, 6), make_field(5, 1), make_field(4, 5),
+    { "..", "X." }, { ".X", "X." }, { "X." , ".." },
+  };
+  for (int trial = 0; trial < 20; ++trial) {
+    fields.push_back(make_random_field(1 + rng() % 7, 1 + rng() % 8, 20, rng));
+  }
+  for (const auto& field : fields) {
+    algorithms::PathCountTables tables(field);
+    auto expected = all_routes(field);
+    ASSERT_EQ(expected.size(), tables.count());
+    std::vector<std::string> listed(tables.paths_begin(), tables.paths_end());
+    EXPECT_EQ(expected, listed);
+    for (uint64_t k = 0; k < expected.size(); ++k) {
+      EXPECT_EQ(expected[k], tables.unrank(k));
+      EXPECT_EQ(k, tables.rank(expected[k]));
+      EXPECT_EQ(expected.size() - k,
+                uint64_t(std::distance(tables.paths_begin(k), tables.paths_end())));
+    }
+    EXPECT_THROW(tables.unrank(expected.size()), std::invalid_argument);
+    EXPECT_TRUE(tables.paths_begin(expected.size()) == tables.paths_end());
+  }
+
+  // random access into billions of routes
+  auto field = make_random_field(30, 40, 5, rng);
+  algorithms::PathCountTables tables(field);
+  ASSERT_GT(tables.count(), uint64_t{1} << 32);
+  for (int trial = 0; trial < 100; ++trial) {
+    const uint64_t k = rng() % tables.count();
+    auto path = tables.unrank(k);
+    EXPECT_EQ(k, tables.rank(path));
+    auto it = tables.paths_begin(k);
+    EXPECT_EQ(path, *it);
+    if (k + 1 < tables.count()) {
+      EXPECT_EQ(tables.unrank(k + 1), *++it);
+    }
+  }
+  EXPECT_EQ(tables.count() - 1, tables.rank(tables.unrank(tables.count() - 1)));
+
+  algorithms::PathCountTables small(make_field(3, 3));
+  EXPECT_EQ(6, small.count());
+  EXPECT_EQ("vv>>", small.unrank(0));
+  EXPECT_EQ(">>vv", small.unrank(5));
+  EXPECT_THROW(small.rank("vv>"), std::invalid_argument);
+  EXPECT_THROW(small.rank("vvv>"), std::invalid_argument);
+  EXPECT_THROW(small.rank("vv>x"), std::invalid_argument);
+  EXPECT_THROW(algorithms::PathCountTables({ ".X.", "...", "..." }).rank(">>vv"),
+               std::invalid_argument);
+  algorithms::PathCountTables residues(make_field(3, 3), 7);
+  EXPECT_THROW(residues.unrank(0), std::invalid_argument);
+  EXPECT_THROW(residues.rank("vv>>"), std::invalid_argument);
+  EXPECT_THROW(residues.paths_begin(), std::invalid_argument);
+}
+
+TEST(path_sampler, path_sampler) {
+  // whether moves is a route of field
+  auto is_route = [](const std::vector<std::string>& field, const char* moves) {
+    size_t i = 0, j = 0;
+    for (size_t move = 0; move + 2 < field.size() + field[0].size(); ++move) {
+      (moves[move] == 'v') ? ++i : ++j;
+      if (i >= field.size() || j >= field[0].size() || field[i][j] != '.') {
+        return false;
+      }
+    }
+    return true;
+  };
+  // log2 of a count given in decimal
+  auto log2_of = [](const std::string& decimal) {
+    const size_t digits = std::min<size_t>(decimal.size(), 17);
+    return (std::log10(std::stod(decimal.substr(0, digits))) + decimal.size() - digits)
+           * std::log2(10.0);
+  };
+
+  // exact draws: every route about equally often
+  std::mt19937_64 rng(25);
+  for (const auto& field : std::vector<std::vector<std::string>>{
+         make_field(3, 4), { "....", ".X..", "...X", "X..." }, make_random_field(5, 6, 20, rng) }) {
+    algorithms::PathCountTables tables(field);
+    if (tables.count() == 0) {
+      EXPECT_THROW(algorithms::PathSampler sampler(field), std::invalid_argument);
+      continue;
+    }
+    algorithms::PathSampler sampler(field);
+    EXPECT_TRUE(sampler.exact());
+    EXPECT_DOUBLE_EQ(std::log2(double(tables.count())), sampler.log2_count());
+    const size_t n = 20000 * tables.count(), length = sampler.path_length();
+    auto moves = sampler.sample(n, rng);
+    ASSERT_EQ(n * length, moves.size());
+    std::vector<size_t> seen(tables.count(), 0);
+    for (size_t k = 0; k < n; ++k) {
+      ++seen[tables.rank(std::string(&moves[k * length], length))];
+    }
+    for (size_t times : seen) {
+      // within 5 standard deviations of 20000
+      EXPECT_NEAR(20000.0, double(times), 5 * std::sqrt(20000.0));
+    }
+  }
+
+  // too many routes for 64 bits: log2 counts, still valid routes, and the
+  // probability of going down first is (routes from (1, 0)) / (routes)
+  std::vector<std::string> field;
+  do {
+    field = make_random_field(100, 100, 5, rng);
+    field[0][1] = field[1][0] = '.';
+  } while (algorithms::soccer_dyn_prog_exact(field).to_string() == "0");
+  algorithms::PathSampler sampler(field);
+  ASSERT_FALSE(sampler.exact());
+  const auto count = algorithms::soccer_dyn_prog_exact(field).to_string();
+  EXPECT_NEAR(log2_of(count), sampler.log2_count(), 1e-9);
+  const std::vector<std::string> below(field.begin() + 1, field.end());
+  const double p_down =
+    std::exp2(log2_of(algorithms::soccer_dyn_prog_exact(below).to_string()) - log2_of(count));
+  const size_t n = 100000, length = sampler.path_length();
+  auto moves = sampler.sample(n, rng);
+  size_t down = 0;
+  for (size_t k = 0; k < n; ++k) {
+    EXPECT_TRUE(is_route(field, &moves[k * length]));
+    down += (moves[k * length] == 'v');
+  }
+  EXPECT_NEAR(p_down * n, double(down), 5 * std::sqrt(n * p_down * (1 - p_down)));
+
+  // route k of a batch depends only on the seed and k
+  auto batch = sampler.sample_seeded(3000, 7);
+  auto prefix = sampler.sample_seeded(10, 7);
+  EXPECT_TRUE(std::equal(prefix.begin(), prefix.end(), batch.begin()));
+  EXPECT_NE(batch, sampler.sample_seeded(3000, 8));
+  EXPECT_EQ(length, sampler.sample(rng).size());
+
+  EXPECT_EQ("", algorithms::PathSampler(make_field(1, 1)).sample(rng));
+  EXPECT_EQ(">>>", algorithms::PathSampler(make_field(1, 4)).sample(rng));
+  EXPECT_THROW(algorithms::PathSampler({ ".X", "X." }), std::invalid_argument);
+  EXPECT_THROW(algorithms::PathSampler({ "..", "X" }), std::invalid_argument);
 }
@@ -0,0 +1,219 @@
+///////////////////////////////////////////////////////////////////////////////
+// repeated.cpp
+//
+// Definitions for soccer_repeated, find_row_blocks and
+// soccer_dyn_prog_periodic.
+//
+// A transfer matrix is stored column by column: column k is the line below
+// the block when the line above it is 1 at k and 0 elsewhere, which is
+// just the DP of the block's rows started from that line, so a block's
+// matrix is built with the same line kernels as soccer_dyn_prog. Entry
+// (j, k) counts the routes entering the block at column k and leaving it
+// at column j, which is 0 for j < k, and products only visit the lower
+// triangle.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "poly_exp.hpp"
+#include "count_arith.hpp"
+#include "dp_kernels.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+  // Estimated cost of one term of a matrix product, in line cells of the
+  // DP; each is a multiply and an add, and a 128-bit remainder modulo p.
+  const double MATRIX_TERM_CELLS = 4;
+
+  template <typename Arith>
+  class TransferMatrix {
+  public:
+    using value_type = typename Arith::value_type;
+
+  private:
+    size_t _size;
+    std::vector<value_type> _entries;
+
+  public:
+    // The matrix of the rows of block, each size cells wide.
+    TransferMatrix(const algorithms::PackedField& block, const Arith& arith)
+      : _size(block.columns()), _entries(_size * _size, arith.zero()) {
+      for (size_t k = 0; k < _size; ++k) {
+        value_type* line = column(k);
+        line[k] = arith.one();
+        for (size_t i = 0; i < block.rows(); ++i) {
+          // columns before k stay 0
+          algorithms::detail::update_line(block.row(i), line, _size,
+                                          arith.zero(), arith);
+        }
+      }
+    }
+
+    value_type* column(size_t k) { return &_entries[k * _size]; }
+    const value_type* column(size_t k) const { return &_entries[k * _size]; }
+
+    // This matrix times other, applying other first.
+    TransferMatrix product(const TransferMatrix& other, const Arith& arith) const {
+      TransferMatrix result(*this);
+      for (size_t k = 0; k < _size; ++k) {
+        const value_type* right = other.column(k);
+        value_type* out = result.column(k);
+        for (size_t j = k; j < _size; ++j) {
+          value_type sum = arith.zero();
+          for (size_t m = k; m <= j; ++m) {
+            arith.add_product(sum, column(m)[j], right[m]);
+          }
+          out[j] = sum;
+        }
+      }
+      return result;
+    }
+
+    // Replace line with this matrix times line.
+    void apply(std::vector<value_type>& line, const Arith& arith) const {
+      std::vector<value_type> result(_size, arith.zero());
+      for (size_t k = 0; k < _size; ++k) {
+        if (line[k] != arith.zero()) {
+          const value_type* entries = column(k);
+          for (size_t j = k; j < _size; ++j) {
+            arith.add_product(result[j], entries[j], line[k]);
+          }
+        }
+      }
+      line.swap(result);
+    }
+  };
+
+  // Rows in all blocks' repetitions, or UINT64_MAX if there are more.
+  std::uint64_t total_rows(const std::vector<algorithms::RowBlock>& blocks) {
+    std::uint64_t rows = 0;
+    for (const auto& block : blocks) {
+      std::uint64_t block_rows;
+      if (__builtin_mul_overflow(std::uint64_t(block.rows.size()),
+                                 block.repetitions, &block_rows) ||
+          __builtin_add_overflow(rows, block_rows, &rows)) {
+        return UINT64_MAX;
+      }
+    }
+    return rows;
+  }
+
+  // The count of the blocks packed[b] repeated repetitions[b] times.
+  template <typename Arith>
+  typename Arith::value_type
+  count_blocks(const std::vector<algorithms::PackedField>& packed,
+               const std::vector<std::uint64_t>& repetitions_of,
+               const Arith& arith) {
+    using value_type = typename Arith::value_type;
+    const size_t columns = packed[0].columns();
+    std::vector<value_type> line(columns, arith.zero());
+    line[0] = arith.one();
+    for (size_t b = 0; b < packed.size(); ++b) {
+      const algorithms::PackedField& block = packed[b];
+      std::uint64_t repetitions = repetitions_of[b];
+      if (repetitions == 0) {
+        continue;
+      }
+      const double sweep_cost = double(repetitions) * block.rows() * columns;
+      const double matrix_cost = double(block.rows()) * columns * columns +
+        std::log2(double(repetitions)) * MATRIX_TERM_CELLS * columns * columns * columns / 6;
+      if (sweep_cost <= matrix_cost) {
+        for (; repetitions != 0; --repetitions) {
+          for (size_t i = 0; i < block.rows(); ++i) {
+            algorithms::detail::update_line(block.row(i), line.data(), columns,
+                                            arith.zero(), arith);
+          }
+        }
+        continue;
+      }
+      TransferMatrix<Arith> power(block, arith);
+      for (;;) {
+        if (repetitions & 1) {
+          power.apply(line, arith);
+        }
+        repetitions >>= 1;
+        if (repetitions == 0) {
+          break;
+        }
+        power = power.product(power, arith);
+      }
+    }
+    return line[columns - 1];
+  }
+
+}
+
+std::uint64_t algorithms::soccer_repeated(const std::vector<RowBlock>& blocks,
+                                          std::uint64_t modulus) {
+  if (total_rows(blocks) == 0) {
+    throw std::invalid_argument("Invalid, empty");
+  }
+  // blocks repeated 0 times still have to be valid
+  std::vector<PackedField> packed;
+  std::vector<std::uint64_t> repetitions;
+  for (const auto& block : blocks) {
+    if (block.rows.empty()) {
+      continue;
+    }
+    packed.emplace_back(block.rows);
+    repetitions.push_back(block.repetitions);
+    if (packed.back().columns() != packed[0].columns()) {
+      throw std::invalid_argument("Invalid, row less");
+    }
+  }
+  return detail::count_with_modulus(modulus, [&](const auto& arith) {
+    return count_blocks(packed, repetitions, arith);
+  });
+}
+
+std::vector<algorithms::RowBlock>
+algorithms::find_row_blocks(const std::vector<std::string>& field) {
+  // rows numbered by their contents, so that rows compare in O(1)
+  std::unordered_map<std::string_view, size_t> numbers;
+  std::vector<size_t> ids;
+  ids.reserve(field.size());
+  for (const auto& row : field) {
+    ids.push_back(numbers.emplace(row, numbers.size()).first->second);
+  }
+
+  std::vector<RowBlock> blocks;
+  auto literal = [&](size_t i) {
+    if (blocks.empty() || blocks.back().repetitions != 1) {
+      blocks.push_back({ {}, 1 });
+    }
+    blocks.back().rows.push_back(field[i]);
+  };
+  for (size_t i = 0; i < ids.size();) {
+    // the block at i whose repeats cover the most rows
+    size_t best_period = 0, best_rows = 0;
+    for (size_t period = 1; period <= MAX_BLOCK_ROWS && i + 2 * period <= ids.size(); ++period) {
+      size_t end = i + period;
+      while (end < ids.size() && ids[end] == ids[end - period]) {
+        ++end;
+      }
+      const size_t rows = (end - i) / period * period;
+      if (rows >= 2 * period && rows > best_rows) {
+        best_period = period;
+        best_rows = rows;
+      }
+    }
+    if (best_period == 0) {
+      literal(i++);
+      continue;
+    }
+    blocks.push_back({ std::vector<std::string>(field.begin() + i,
+                                                field.begin() + i + best_period),
+                       best_rows / best_period });
+    i += best_rows;
+  }
+  return blocks;
+}
+
+std::uint64_t algorithms::soccer_dyn_prog_periodic(const std::vector<std::string>& field,
+                                                   std::uint64_t modulus) {
+  return soccer_repeated(find_row_blocks(field), modulus);
+}
@@ -0,0 +1,225 @@
+///////////////////////////////////////////////////////////////////////////////
+// solve_cache.cpp
+//
+// Definitions for field_hash and SolveCache.
+//
+// Each lane of the hash folds the 128-bit product of its state and the
+// next row word, both offset by lane constants, into 64 bits, so every
+// word passes through a full multiply and the two lanes run side by side.
+// The word and the old state are added back to the product, since a word
+// equal to a lane constant makes it 0 and would otherwise wipe out the
+// rows hashed before.
+// The shape seeds both lanes and a final mix spreads every bit of a lane
+// over its whole result. Rows contribute their (c + 63) / 64 words, not
+// their padding, and character fields are packed CHUNK_WORDS words at a
+// time into a buffer on the stack.
+//
+// A shard keeps its entries in a std::list, most recently used first, and
+// an std::unordered_map from key to list node; a hit splices its node to
+// the front, and an insert past the shard's capacity evicts the back.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "solve_cache.hpp"
+#include "dp_kernels.hpp"
+
+#include <algorithm>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+  const std::uint64_t LANE_LOW[2] = { 0x9E3779B97F4A7C15ULL, 0xBF58476D1CE4E5B9ULL };
+  const std::uint64_t LANE_HIGH[2] = { 0x94D049BB133111EBULL, 0xC2B2AE3D27D4EB4FULL };
+
+  // Row words packed per step when hashing a character field.
+  const size_t CHUNK_WORDS = 64;
+
+  std::uint64_t fold(std::uint64_t a, std::uint64_t b) {
+    const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    return static_cast<std::uint64_t>(product) ^ static_cast<std::uint64_t>(product >> 64);
+  }
+
+  // The finalizer of MurmurHash3.
+  std::uint64_t mix(std::uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    return x ^ (x >> 33);
+  }
+
+  class Hasher {
+  private:
+    std::uint64_t _low, _high;
+
+  public:
+    Hasher(size_t rows, size_t columns)
+      : _low(fold(rows ^ LANE_LOW[0], columns ^ LANE_LOW[1])),
+        _high(fold(rows ^ LANE_HIGH[0], columns ^ LANE_HIGH[1])) {}
+
+    void add(const std::uint64_t* words, size_t count) {
+      std::uint64_t low = _low, high = _high;
+      for (size_t w = 0; w < count; ++w) {
+        low = fold(low ^ LANE_LOW[0], words[w] ^ LANE_LOW[1]) + words[w] + low;
+        high = fold(high ^ LANE_HIGH[0], words[w] ^ LANE_HIGH[1]) + words[w] + high;
+      }
+      _low = low;
+      _high = high;
+    }
+
+    algorithms::FieldHash result() const {
+      return { mix(_low), mix(_high ^ _low) };
+    }
+  };
+
+  struct FieldHashHasher {
+    size_t operator()(const algorithms::FieldHash& key) const {
+      return key.low;
+    }
+  };
+
+}
+
+algorithms::FieldHash algorithms::field_hash(const PackedField& field) {
+  Hasher hasher(field.rows(), field.columns());
+  const size_t words = (field.columns() + 63) / 64;
+  for (size_t i = 0; i < field.rows(); ++i) {
+    hasher.add(field.row(i), words);
+  }
+  return hasher.result();
+}
+
+algorithms::FieldHash algorithms::field_hash(FieldView field) {
+  const size_t rows = field.rows(), columns = field.columns();
+  if (rows == 0 || columns == 0) {
+    throw std::invalid_argument("Invalid, empty");
+  }
+  Hasher hasher(rows, columns);
+  std::uint64_t buffer[CHUNK_WORDS];
+  for (size_t i = 0; i < rows; ++i) {
+    if (field.row_size(i) != columns) {
+      throw std::invalid_argument("Invalid, row less");
+    }
+    const char* cells = field.row(i);
+    for (size_t j = 0; j < columns; j += 64 * CHUNK_WORDS) {
+      const size_t length = std::min(columns - j, 64 * CHUNK_WORDS);
+      const size_t words = (length + 63) / 64;
+      // pack_row only ORs the bits of a partial last word in
+      buffer[words - 1] = 0;
+      if (!detail::pack_row(cells + j, length, buffer)) {
+        throw std::invalid_argument("Invalid, character");
+      }
+      hasher.add(buffer, words);
+    }
+  }
+  return hasher.result();
+}
+
+struct algorithms::SolveCache::Shard {
+  using Entry = std::pair<FieldHash, int>;
+
+  std::mutex lock;
+  std::list<Entry> order;
+  std::unordered_map<FieldHash, std::list<Entry>::iterator, FieldHashHasher> index;
+  size_t capacity{1};
+  Counters counters;
+};
+
+algorithms::SolveCache::SolveCache(size_t max_bytes)
+  : _max_bytes(max_bytes), _shards(new Shard[SHARDS]) {
+  const size_t capacity = std::max<size_t>(1, max_bytes / SHARDS / ENTRY_BYTES);
+  for (size_t s = 0; s < SHARDS; ++s) {
+    _shards[s].capacity = capacity;
+    _shards[s].index.reserve(std::min<size_t>(capacity, 1024));
+  }
+}
+
+algorithms::SolveCache::~SolveCache() = default;
+
+int algorithms::SolveCache::soccer_dyn_prog(const std::vector<std::string>& field) {
+  return soccer_dyn_prog(FieldView(field));
+}
+
+int algorithms::SolveCache::soccer_dyn_prog(FieldView field) {
+  const FieldHash key = field_hash(field);
+  int result;
+  if (!find(key, result)) {
+    result = algorithms::soccer_dyn_prog(PackedField(field));
+    insert(key, result);
+  }
+  return result;
+}
+
+int algorithms::SolveCache::soccer_dyn_prog(const PackedField& field) {
+  const FieldHash key = field_hash(field);
+  int result;
+  if (!find(key, result)) {
+    result = algorithms::soccer_dyn_prog(field);
+    insert(key, result);
+  }
+  return result;
+}
+
+algorithms::SolveCache::Counters algorithms::SolveCache::counters() const {
+  Counters total;
+  for (size_t s = 0; s < SHARDS; ++s) {
+    std::lock_guard<std::mutex> guard(_shards[s].lock);
+    const Counters& counters = _shards[s].counters;
+    total.hits += counters.hits;
+    total.misses += counters.misses;
+    total.evictions += counters.evictions;
+    total.entries += counters.entries;
+  }
+  total.bytes = total.entries * ENTRY_BYTES;
+  return total;
+}
+
+void algorithms::SolveCache::clear() {
+  for (size_t s = 0; s < SHARDS; ++s) {
+    std::lock_guard<std::mutex> guard(_shards[s].lock);
+    _shards[s].order.clear();
+    _shards[s].index.clear();
+    _shards[s].counters.entries = 0;
+  }
+}
+
+algorithms::SolveCache::Shard&
+algorithms::SolveCache::shard(const FieldHash& key) const {
+  // the high half, independent of the low half the hash table uses
+  return _shards[key.high % SHARDS];
+}
+
+bool algorithms::SolveCache::find(const FieldHash& key, int& result) {
+  Shard& s = shard(key);
+  std::lock_guard<std::mutex> guard(s.lock);
+  auto found = s.index.find(key);
+  if (found == s.index.end()) {
+    ++s.counters.misses;
+    return false;
+  }
+  ++s.counters.hits;
+  s.order.splice(s.order.begin(), s.order, found->second);
+  result = found->second->second;
+  return true;
+}
+
+void algorithms::SolveCache::insert(const FieldHash& key, int result) {
+  Shard& s = shard(key);
+  std::lock_guard<std::mutex> guard(s.lock);
+  if (s.index.count(key) != 0) {
+    // another thread solved the same field meanwhile
+    return;
+  }
+  if (s.order.size() == s.capacity) {
+    s.index.erase(s.order.back().first);
+    s.order.pop_back();
+    ++s.counters.evictions;
+  } else {
+    ++s.counters.entries;
+  }
+  s.order.emplace_front(key, result);
+  s.index.emplace(key, s.order.begin());
+}
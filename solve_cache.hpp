@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+// solve_cache.hpp
+//
+// A thread-safe cache of soccer_dyn_prog results for fields that are asked
+// about again and again.
+//
+// Fields are content-addressed: the key is a 128-bit hash of the packed
+// field's bits and its dimensions, so a std::vector<std::string>, a
+// FieldView and a PackedField of the same field share an entry. Character
+// fields are packed row by row into a small buffer while they are hashed,
+// which also validates them, and are only packed in full on a miss. The
+// hash is not cryptographic, but two different fields sharing a key is
+// unlikely enough that the cache accepts it instead of storing every
+// field to compare.
+//
+// Entries live in SHARDS independently locked shards, picked by the key,
+// each keeping its own least recently used order. A shard's lock is held
+// only to look up, insert or evict, never while solving, so threads
+// mostly touch different shards and never wait for a solve. Two threads
+// missing the same field at once both solve it.
+//
+// How to use:
+//
+//    SolveCache cache(16 << 20);           // at most about 16 MiB
+//    int routes = cache.soccer_dyn_prog(field);
+//    SolveCache::Counters counters = cache.counters();
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "poly_exp.hpp"
+
+namespace algorithms {
+
+  // 128-bit content hash of a field, see field_hash.
+  struct FieldHash {
+    std::uint64_t low, high;
+
+    bool operator==(const FieldHash& other) const {
+      return low == other.low && high == other.high;
+    }
+  };
+
+  // Hash of the bits and dimensions of field: two lanes of 64x64 to 128-bit
+  // multiplies over the row words, folded and mixed with the shape.
+  FieldHash field_hash(const PackedField& field);
+
+  // field_hash of the packed field, without packing it in full.
+  //
+  // Throws std::invalid_argument if field is invalid, as PackedField does.
+  FieldHash field_hash(FieldView field);
+
+  class SolveCache {
+  public:
+    static const size_t SHARDS = 16;
+
+    // Bytes charged for each entry: the key, the result, the LRU list node
+    // and the hash table node and bucket.
+    static const size_t ENTRY_BYTES = 96;
+
+    struct Counters {
+      std::uint64_t hits{0}, misses{0}, evictions{0};
+      // entries held, and the bytes charged for them
+      std::uint64_t entries{0}, bytes{0};
+    };
+
+    // A cache holding at most max_bytes of entries, split evenly between
+    // the shards; each shard holds at least one entry.
+    explicit SolveCache(size_t max_bytes = size_t{64} << 20);
+
+    ~SolveCache();
+
+    SolveCache(const SolveCache&) = delete;
+    SolveCache& operator=(const SolveCache&) = delete;
+
+    size_t max_bytes() const { return _max_bytes; }
+
+    // The result of algorithms::soccer_dyn_prog(field), from the cache when
+    // the field was solved before.
+    //
+    // Throws std::invalid_argument if field is invalid; invalid fields are
+    // never cached.
+    int soccer_dyn_prog(const std::vector<std::string>& field);
+
+    int soccer_dyn_prog(FieldView field);
+
+    int soccer_dyn_prog(const PackedField& field);
+
+    // Sums over the shards, each read under its lock.
+    Counters counters() const;
+
+    // Drop every entry; the hit, miss and eviction counters are kept.
+    void clear();
+
+  private:
+    struct Shard;
+
+    size_t _max_bytes;
+    std::unique_ptr<Shard[]> _shards;
+
+    Shard& shard(const FieldHash& key) const;
+
+    // The cached result for key, counting a hit or a miss.
+    bool find(const FieldHash& key, int& result);
+
+    void insert(const FieldHash& key, int result);
+  };
+
+}
@@ -0,0 +1,264 @@
+///////////////////////////////////////////////////////////////////////////////
+// sparse.cpp
+//
+// Definitions for soccer_sparse, soccer_sparse_exact and
+// soccer_count_obstacles.
+//
+// The routes from (a, b) to (c, d) number C((c - a) + (d - b), c - a) when
+// c >= a and d >= b, and are looked up in factorial and inverse factorial
+// tables modulo a prime p > r + c - 2, so that every factorial involved is
+// invertible. Obstacles are sorted by row, then column, which puts every
+// obstacle a route can visit before obstacle i ahead of i.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "poly_exp.hpp"
+#include "count_arith.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+  // Estimated cost of one obstacle pair of soccer_sparse, in cells of the
+  // DP; each pair does a binomial lookup, two products and two remainders.
+  const double SPARSE_PAIR_CELLS = 6;
+
+  // Bits of residue each prime near 2^63 contributes to an exact count.
+  const double PRIME_BITS = 62;
+
+  std::uint64_t mul_mod(std::uint64_t a, std::uint64_t b, std::uint64_t m) {
+    return static_cast<std::uint64_t>(static_cast<unsigned __int128>(a) * b % m);
+  }
+
+  std::uint64_t pow_mod(std::uint64_t base, std::uint64_t exponent,
+                        std::uint64_t m) {
+    std::uint64_t result = 1 % m;
+    for (base %= m; exponent != 0; exponent >>= 1) {
+      if (exponent & 1) {
+        result = mul_mod(result, base, m);
+      }
+      base = mul_mod(base, base, m);
+    }
+    return result;
+  }
+
+  // Miller-Rabin with the first twelve primes as bases, which is exact for
+  // every 64-bit n.
+  bool is_prime(std::uint64_t n) {
+    const std::uint64_t BASES[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 };
+    if (n < 2) {
+      return false;
+    }
+    for (auto base : BASES) {
+      if (n % base == 0) {
+        return n == base;
+      }
+    }
+    std::uint64_t odd = n - 1;
+    int twos = 0;
+    while ((odd & 1) == 0) {
+      odd >>= 1;
+      ++twos;
+    }
+    for (auto base : BASES) {
+      std::uint64_t x = pow_mod(base, odd, n);
+      if (x == 1 || x == n - 1) {
+        continue;
+      }
+      bool composite = true;
+      for (int k = 1; k < twos && composite; ++k) {
+        x = mul_mod(x, x, n);
+        composite = (x != n - 1);
+      }
+      if (composite) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Whether soccer_sparse can count modulo modulus on a field whose routes
+  // are length moves long.
+  bool usable_modulus(std::uint64_t modulus, size_t length) {
+    return modulus > length && modulus < (std::uint64_t{1} << 63) &&
+           is_prime(modulus);
+  }
+
+  // Binomial coefficients C(n, k) modulo a prime p, for n up to a bound
+  // below p.
+  class BinomialTable {
+  private:
+    std::uint64_t _p;
+    std::vector<std::uint64_t> _factorial, _inverse;
+
+  public:
+    BinomialTable(size_t bound, std::uint64_t p)
+      : _p(p), _factorial(bound + 1), _inverse(bound + 1) {
+      _factorial[0] = 1;
+      for (size_t k = 1; k <= bound; ++k) {
+        _factorial[k] = mul_mod(_factorial[k - 1], k, p);
+      }
+      // 1 / k! = (k + 1) / (k + 1)!, from Fermat's inverse of bound!
+      _inverse[bound] = pow_mod(_factorial[bound], p - 2, p);
+      for (size_t k = bound; k > 0; --k) {
+        _inverse[k - 1] = mul_mod(_inverse[k], k, p);
+      }
+    }
+
+    std::uint64_t modulus() const { return _p; }
+
+    // Routes that make down moves 'v' and right moves '>'.
+    std::uint64_t paths(size_t down, size_t right) const {
+      return mul_mod(mul_mod(_factorial[down + right], _inverse[down], _p),
+                     _inverse[right], _p);
+    }
+  };
+
+  // The obstacles sorted and without repeats, followed by the goal.
+  //
+  // Throws std::invalid_argument if the field is empty or an obstacle is
+  // outside it.
+  std::vector<algorithms::FieldCell>
+  sorted_points(size_t rows, size_t columns,
+                const std::vector<algorithms::FieldCell>& obstacles) {
+    if (rows == 0 || columns == 0) {
+      throw std::invalid_argument("Invalid, empty");
+    }
+    std::vector<algorithms::FieldCell> points(obstacles);
+    for (const auto& cell : points) {
+      if (cell.row >= rows || cell.column >= columns) {
+        throw std::invalid_argument("Invalid, cell");
+      }
+    }
+    auto before = [](const algorithms::FieldCell& a, const algorithms::FieldCell& b) {
+      return (a.row != b.row) ? a.row < b.row : a.column < b.column;
+    };
+    auto same = [](const algorithms::FieldCell& a, const algorithms::FieldCell& b) {
+      return a.row == b.row && a.column == b.column;
+    };
+    std::sort(points.begin(), points.end(), before);
+    points.erase(std::unique(points.begin(), points.end(), same), points.end());
+    points.push_back({rows - 1, columns - 1});
+    return points;
+  }
+
+  // The count modulo table.modulus(), where points ends with the goal.
+  std::uint64_t count_mod(const std::vector<algorithms::FieldCell>& points,
+                          const BinomialTable& table) {
+    const std::uint64_t p = table.modulus();
+    // first[i]: routes to point i that avoid every earlier obstacle
+    std::vector<std::uint64_t> first(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+      const auto& to = points[i];
+      std::uint64_t count = table.paths(to.row, to.column);
+      for (size_t j = 0; j < i; ++j) {
+        const auto& from = points[j];
+        if (from.column <= to.column && first[j] != 0) {
+          const std::uint64_t through = mul_mod(
+            first[j], table.paths(to.row - from.row, to.column - from.column), p);
+          count = (count >= through) ? count - through : count + p - through;
+        }
+      }
+      first[i] = count;
+    }
+    return first.back();
+  }
+
+  // log2 of C(n, k), the routes of the field without obstacles and so an
+  // upper bound of every count.
+  double log2_binomial(size_t n, size_t k) {
+    return (std::lgamma(n + 1.0) - std::lgamma(k + 1.0) - std::lgamma(n - k + 1.0))
+           / std::log(2.0);
+  }
+
+  // Number of primes near 2^63 whose product exceeds every count.
+  size_t primes_needed(size_t rows, size_t columns) {
+    return size_t(log2_binomial(rows + columns - 2, rows - 1) / PRIME_BITS) + 2;
+  }
+
+  // The exact count, from its residues modulo primes primes near 2^63.
+  algorithms::BigUnsigned count_exact(const std::vector<algorithms::FieldCell>& points,
+                                      size_t rows, size_t columns, size_t primes) {
+    std::vector<std::uint64_t> moduli, residues;
+    for (std::uint64_t candidate = (std::uint64_t{1} << 63) - 1;
+         moduli.size() < primes; candidate -= 2) {
+      if (is_prime(candidate)) {
+        moduli.push_back(candidate);
+        residues.push_back(count_mod(points, BinomialTable(rows + columns - 2, candidate)));
+      }
+    }
+    return algorithms::detail::crt_combine(residues, moduli);
+  }
+
+  // Whether the start or goal is an obstacle, so no route exists.
+  bool corner_blocked(const std::vector<algorithms::FieldCell>& points,
+                      size_t rows, size_t columns) {
+    const size_t k = points.size() - 1;
+    return (k > 0 && points[0].row == 0 && points[0].column == 0) ||
+           (k > 0 && points[k - 1].row == rows - 1 && points[k - 1].column == columns - 1);
+  }
+
+}
+
+std::uint64_t algorithms::soccer_sparse(size_t rows, size_t columns,
+                                        const std::vector<FieldCell>& obstacles,
+                                        std::uint64_t modulus) {
+  auto points = sorted_points(rows, columns, obstacles);
+  const size_t length = rows + columns - 2;
+  if (modulus != 0 && !usable_modulus(modulus, length)) {
+    throw std::invalid_argument("Invalid, modulus");
+  }
+  if (corner_blocked(points, rows, columns)) {
+    return 0;
+  }
+  if (modulus != 0) {
+    return count_mod(points, BinomialTable(length, modulus));
+  }
+  BigUnsigned count = count_exact(points, rows, columns, primes_needed(rows, columns));
+  if (!count.fits_u64()) {
+    throw std::overflow_error("Overflow, count does not fit in 64 bits");
+  }
+  return count.to_u64();
+}
+
+algorithms::BigUnsigned
+algorithms::soccer_sparse_exact(size_t rows, size_t columns,
+                                const std::vector<FieldCell>& obstacles) {
+  auto points = sorted_points(rows, columns, obstacles);
+  if (corner_blocked(points, rows, columns)) {
+    return BigUnsigned();
+  }
+  return count_exact(points, rows, columns, primes_needed(rows, columns));
+}
+
+std::uint64_t
+algorithms::soccer_count_obstacles(size_t rows, size_t columns,
+                                   const std::vector<FieldCell>& obstacles,
+                                   std::uint64_t modulus) {
+  // validates the field for both solvers
+  const size_t k = sorted_points(rows, columns, obstacles).size() - 1;
+  const size_t length = rows + columns - 2;
+  if (modulus == 0 || usable_modulus(modulus, length)) {
+    const double primes = (modulus == 0) ? primes_needed(rows, columns) : 1;
+    const double sparse_cost = primes * (length + SPARSE_PAIR_CELLS * k * k / 2);
+    if (sparse_cost < double(rows) * columns) {
+      return soccer_sparse(rows, columns, obstacles, modulus);
+    }
+  }
+
+  PackedField field(rows, columns);
+  const size_t words = (columns + PackedField::WORD_BITS - 1) / PackedField::WORD_BITS;
+  const size_t tail = columns % PackedField::WORD_BITS;
+  for (size_t i = 0; i < rows; ++i) {
+    std::fill(field.row(i), field.row(i) + words, ~std::uint64_t{0});
+    if (tail != 0) {
+      field.row(i)[words - 1] = (std::uint64_t{1} << tail) - 1;
+    }
+  }
+  for (const auto& cell : obstacles) {
+    field.set_open(cell.row, cell.column, false);
+  }
+  return soccer_dyn_prog_parallel(field, 0, modulus);
+}
@@ -0,0 +1,175 @@
+///////////////////////////////////////////////////////////////////////////////
+// thread_pool.cpp
+//
+// Definitions for ThreadPool and TaskGroup.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+  // The pool the calling thread works for, and its index in that pool.
+  thread_local const algorithms::ThreadPool* current_pool = nullptr;
+  thread_local size_t current_index = 0;
+
+  // How long a waiting TaskGroup sleeps before looking for work to help
+  // with again.
+  const auto HELP_INTERVAL = std::chrono::microseconds(200);
+
+}
+
+algorithms::ThreadPool::ThreadPool(size_t threads)
+  : _queued(0), _stopping(false) {
+  if (threads == 0) {
+    threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+  }
+  for (size_t i = 0; i <= threads; ++i) {
+    _queues.emplace_back(new Queue);
+  }
+  for (size_t i = 0; i < threads; ++i) {
+    _threads.emplace_back([this, i] { worker_loop(i); });
+  }
+}
+
+algorithms::ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> guard(_sleep_lock);
+    _stopping = true;
+  }
+  _wake.notify_all();
+  for (auto& thread : _threads) {
+    thread.join();
+  }
+}
+
+size_t algorithms::ThreadPool::current_worker() const {
+  return (current_pool == this) ? current_index : size();
+}
+
+void algorithms::ThreadPool::submit(task work) {
+  Queue& queue = *_queues[current_worker()];
+  {
+    std::lock_guard<std::mutex> guard(queue.lock);
+    queue.tasks.push_back(std::move(work));
+  }
+  {
+    // Taking the sleep lock orders this increment against a worker that
+    // has just found nothing to do and is about to sleep.
+    std::lock_guard<std::mutex> guard(_sleep_lock);
+    _queued.fetch_add(1, std::memory_order_release);
+  }
+  _wake.notify_one();
+}
+
+bool algorithms::ThreadPool::try_pop(size_t self, task& work) {
+  if (_queued.load(std::memory_order_acquire) == 0) {
+    return false;
+  }
+  const size_t count = _queues.size();
+  // Own deque first, newest task; then steal the oldest task of the others,
+  // starting with the injection queue.
+  for (size_t k = 0; k < count; ++k) {
+    size_t victim = (k == 0) ? self : (self + count - k) % count;
+    Queue& queue = *_queues[victim];
+    std::lock_guard<std::mutex> guard(queue.lock);
+    if (queue.tasks.empty()) {
+      continue;
+    }
+    if (victim == self && self != size()) {
+      work = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    } else {
+      work = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+    _queued.fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+  }
+  return false;
+}
+
+bool algorithms::ThreadPool::run_pending_task() {
+  task work;
+  if (!try_pop(current_worker(), work)) {
+    return false;
+  }
+  work();
+  return true;
+}
+
+void algorithms::ThreadPool::worker_loop(size_t self) {
+  current_pool = this;
+  current_index = self;
+  for (;;) {
+    task work;
+    if (try_pop(self, work)) {
+      work();
+      continue;
+    }
+    std::unique_lock<std::mutex> guard(_sleep_lock);
+    _wake.wait(guard, [this] {
+      return _stopping || _queued.load(std::memory_order_acquire) != 0;
+    });
+    if (_stopping && _queued.load(std::memory_order_acquire) == 0) {
+      return;
+    }
+  }
+}
+
+algorithms::ThreadPool& algorithms::ThreadPool::shared() {
+  static ThreadPool pool;
+  return pool;
+}
+
+algorithms::TaskGroup::~TaskGroup() {
+  try {
+    wait();
+  } catch (...) {
+  }
+}
+
+void algorithms::TaskGroup::run(ThreadPool::task work) {
+  _pending.fetch_add(1, std::memory_order_relaxed);
+  _pool.submit([this, work = std::move(work)] {
+    try {
+      work();
+    } catch (...) {
+      std::lock_guard<std::mutex> guard(_lock);
+      if (!_error) {
+        _error = std::current_exception();
+      }
+    }
+    finish_one();
+  });
+}
+
+void algorithms::TaskGroup::finish_one() {
+  // Decrement under the lock: wait() takes the lock once more after seeing
+  // zero, so the group cannot be destroyed while this is still using it.
+  std::lock_guard<std::mutex> guard(_lock);
+  if (_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    _done.notify_all();
+  }
+}
+
+void algorithms::TaskGroup::wait() {
+  while (_pending.load(std::memory_order_acquire) != 0) {
+    if (_pool.run_pending_task()) {
+      continue;
+    }
+    std::unique_lock<std::mutex> guard(_lock);
+    _done.wait_for(guard, HELP_INTERVAL, [this] {
+      return _pending.load(std::memory_order_acquire) == 0;
+    });
+  }
+  std::lock_guard<std::mutex> guard(_lock);
+  if (_error) {
+    std::exception_ptr error = _error;
+    _error = nullptr;
+    std::rethrow_exception(error);
+  }
+}
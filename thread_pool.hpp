@@ -0,0 +1,118 @@
+///////////////////////////////////////////////////////////////////////////////
+// thread_pool.hpp
+//
+// Work-stealing thread pool used by the parallel solvers.
+//
+// Every worker owns a task deque. A worker pushes tasks it spawns onto the
+// back of its own deque and pops from the back, so dependent work stays hot
+// in its cache; an idle worker steals from the front of another worker's
+// deque. Tasks submitted from outside the pool go to a shared injection
+// queue that every worker also steals from.
+//
+// How to use:
+//
+//    ThreadPool pool(4);
+//    TaskGroup group(pool);
+//    for (...) {
+//      group.run([=] { ... });   // may itself call group.run
+//    }
+//    group.wait();               // helps run tasks until all have finished
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace algorithms {
+
+  class ThreadPool {
+  public:
+    using task = std::function<void()>;
+
+    // Start a pool of threads workers; 0 means one per hardware thread.
+    explicit ThreadPool(size_t threads = 0);
+
+    // Finish all queued tasks, then join the workers.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of worker threads.
+    size_t size() const { return _threads.size(); }
+
+    // Queue a task. Called from one of this pool's workers, the task goes
+    // to that worker's own deque; otherwise to the injection queue.
+    void submit(task work);
+
+    // Run one queued task on the calling thread, if there is one. Returns
+    // whether a task was run. Lets threads that wait on tasks help instead
+    // of blocking.
+    bool run_pending_task();
+
+    // Index of the calling worker in [0, size()), or size() when the caller
+    // is not one of this pool's workers.
+    size_t current_worker() const;
+
+    // A process-wide pool with one worker per hardware thread, started on
+    // first use and kept for the life of the process.
+    static ThreadPool& shared();
+
+  private:
+    struct Queue {
+      std::mutex lock;
+      std::deque<task> tasks;
+    };
+
+    // _queues[i] belongs to worker i; _queues[size()] is the injection queue.
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread> _threads;
+
+    std::mutex _sleep_lock;
+    std::condition_variable _wake;
+    std::atomic<size_t> _queued;
+    bool _stopping;
+
+    bool try_pop(size_t self, task& work);
+    void worker_loop(size_t self);
+  };
+
+  // Tracks a set of tasks running on a ThreadPool, so they can be awaited
+  // together. Tasks may add more tasks to their own group.
+  class TaskGroup {
+  public:
+    explicit TaskGroup(ThreadPool& pool) : _pool(pool), _pending(0) {}
+
+    // Waits for outstanding tasks; an exception they threw is dropped.
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(ThreadPool::task work);
+
+    // Run queued tasks on the calling thread until every task of this group
+    // has finished, then rethrow the first exception any of them threw.
+    void wait();
+
+  private:
+    ThreadPool& _pool;
+    std::atomic<size_t> _pending;
+    std::mutex _lock;
+    std::condition_variable _done;
+    std::exception_ptr _error;
+
+    void finish_one();
+  };
+
+}
@@ -9,19 +9,27 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdlib>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <random>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "poly_exp.hpp"
 #include "timer.hpp"
 
-enum class algo_choice { dyn, exh };
+enum class algo_choice { dyn, exh, mitm };
 
 const size_t MIN_N{4},
-  MAX_PREVIEW_ROWS{20};
+  MAX_PREVIEW_ROWS{20},
+  DEFAULT_BATCH_FIELDS{10000},
+  DEFAULT_SWEEP_REPS{30},
+  DEFAULT_SWEEP_WARMUP{3};
 
 // probability of an X cell is 1 / X_PROBABILITY
 const int X_PROBABILITY{5};
@@ -32,78 +40,63 @@ void print_bar() {
 
 void print_usage() {
   std::cout << "usage:" << std::endl << std::endl
-	    << "    timing <ALGO> <N>" << std::endl << std::endl
+	    << "    timing <ALGO> <N>" << std::endl
+	    << "    timing scale <N> [<THREADS>]" << std::endl
+	    << "    timing batch <N> [<FIELDS>]" << std::endl
+	    << "    timing sweep <ALGO> <MIN_N> <MAX_N> [--step x<K>|+<K>] [--reps <R>]" << std::endl
+	    << "                 [--warmup <W>] [--seed <S>] [--csv <PATH>]" << std::endl << std::endl
 	    << "where" << std::endl << std::endl
-	    << "    <ALGO> is one of: dyn exh" << std::endl
+	    << "    <ALGO> is one of: dyn exh mitm" << std::endl
 	    << "    <N> is an integer string length (at least " << MIN_N << ")" << std::endl
+	    << "    <THREADS> is the largest thread count to report (default: hardware threads)" << std::endl
+	    << "    <FIELDS> is the number of fields in the batch (default: " << DEFAULT_BATCH_FIELDS << ")" << std::endl
+	    << std::endl
+	    << "scale runs the parallel dynamic programming solver on one field with"  << std::endl
+	    << "1, 2, ..., <THREADS> threads and reports the speedup over 1 thread." << std::endl
+	    << "batch solves <FIELDS> fields with soccer_dyn_prog_batch and reports" << std::endl
+	    << "the throughput in fields per second." << std::endl
+	    << "sweep times <ALGO> <R> times (default: " << DEFAULT_SWEEP_REPS << "), after <W> untimed runs" << std::endl
+	    << "(default: " << DEFAULT_SWEEP_WARMUP << "), for n from <MIN_N> to <MAX_N>, multiplying n by <K> (x<K>," << std::endl
+	    << "default x2) or adding <K> (+<K>) each step. Fields come from std::mt19937_64" << std::endl
+	    << "seeded with <S> (default: the time). It reports min, median, p95 and stddev" << std::endl
+	    << "per n, fits the medians to c * n^k and to c * b^n, and writes one CSV row" << std::endl
+	    << "per n to <PATH>, or to standard output after the report." << std::endl
 	    << std::endl
 	    << "Example:" << std::endl
 	    << "    $ ./timing dyn 5000" << std::endl
+	    << "    $ ./timing scale 40000 8" << std::endl
+	    << "    $ ./timing batch 28 100000" << std::endl
+	    << "    $ ./timing sweep dyn 1000 100000 --step x2 --reps 30 --warmup 3 --seed 42" << std::endl
 	    << std::endl;
 }
 
-int main(int argc, char* argv[]) {
-
-  // Exit codes
-  const int SUCCESS = 0, USAGE_ERROR = 1;
-
-  // First, try to parse commandline arguments for algo choice and n.
-  algo_choice algo;
-  size_t n;
-  
-  if (argc != 3) {
-    print_usage();
-    return USAGE_ERROR;
-  }
-
-  std::string algo_str{argv[1]},
-    n_str{argv[2]};
-
-  if (algo_str == "dyn") {
-    algo = algo_choice::dyn;
-  } else if (algo_str == "exh") {
-    algo = algo_choice::exh;
-  } else {
-    std::cout << "error: unknown <ALGO> \"" << algo_str << "\""
-      	      << std::endl << std::endl;
-    print_usage();
-    return USAGE_ERROR;
-  }
-
-  long n_signed;
+// Parse a commandline integer that must be at least minimum. Prints an error
+// and the usage and returns false if it is not.
+bool parse_size(const std::string& name, const std::string& text,
+                size_t minimum, size_t& result) {
+  long value;
   try {
-    n_signed = std::stol(n_str);
-  } catch (std::exception e) {
-    std::cout << "error: <N> must be an integer"
+    value = std::stol(text);
+  } catch (std::exception& e) {
+    std::cout << "error: " << name << " must be an integer"
 	            << std::endl << std::endl;
     print_usage();
-    return USAGE_ERROR;
+    return false;
   }
-  if (n_signed < 0) {
-    std::cout << "error: <N> must be non-negative"
+  if ((value < 0) || (static_cast<size_t>(value) < minimum)) {
+    std::cout << "error: " << name << " must be at least " << minimum
 	            << std::endl << std::endl;
     print_usage();
-    return USAGE_ERROR;
-  }
-  n = n_signed;
-  if (n < MIN_N) {
-    std::cout << "error: <N> must be at least " << MIN_N
-	            << std::endl << std::endl;
-    print_usage();
-    return USAGE_ERROR;
+    return false;
   }
+  result = value;
+  return true;
+}
 
-  // n should be initialized
-  assert(n >= MIN_N);
-
-  // check maximimum exhaustive search size
-  if ((algo == algo_choice::exh) && (n >= 32)) {
-    std::cout << "error: exhaustive search is limited to n < 32" << std::endl;
-    return USAGE_ERROR;
-  }
+// Build a random field with n = r + c - 2, from a std::mt19937_64 seeded
+// with seed, so that the same seed always gives the same field.
+std::vector<std::string> make_random_field(size_t n, std::uint64_t seed) {
 
-  // build a grid
-  
   // first calculate r and c according to n = r + c - 2
   assert(n >= 2);
   size_t r = (n - 2) / 2,
@@ -114,10 +107,11 @@ int main(int argc, char* argv[]) {
   std::vector<std::string> field(r, std::string(c, '.'));
 
   // add random Xs
-  srand(time(0));
+  std::mt19937_64 rng(seed);
+  std::uniform_int_distribution<int> cell(0, X_PROBABILITY - 1);
   for (size_t i = 0; i < r; ++i) {
     for (size_t j = 0; j < c; ++j) {
-      if ((rand() % X_PROBABILITY) == 0) {
+      if (cell(rng) == 0) {
         field[i][j] = 'X';
       }
     }
@@ -125,23 +119,447 @@ int main(int argc, char* argv[]) {
   // ensure that top-left and bottom-right corners are '.', otherwise the
   // input is trivial
   field[0][0] = field[r-1][c-1] = '.';
-  
-  // prepare to run algorithm with timer
-  Timer timer;    // see timer.hpp
-  double elapsed; // elapsed time in seconds
 
-  print_bar();
-  std::cout << "algo = ";
+  return field;
+}
+
+// Build a random field with n = r + c - 2.
+std::vector<std::string> make_random_field(size_t n) {
+  return make_random_field(n, time(0));
+}
+
+// Parse a commandline algorithm name. Prints an error and the usage and
+// returns false if it is unknown.
+bool parse_algo(const std::string& text, algo_choice& result) {
+  if (text == "dyn") {
+    result = algo_choice::dyn;
+  } else if (text == "exh") {
+    result = algo_choice::exh;
+  } else if (text == "mitm") {
+    result = algo_choice::mitm;
+  } else {
+    std::cout << "error: unknown <ALGO> \"" << text << "\""
+      	      << std::endl << std::endl;
+    print_usage();
+    return false;
+  }
+  return true;
+}
+
+// Check that algo can solve fields of size n. Prints an error and returns
+// false if it cannot.
+bool check_algo_size(algo_choice algo, size_t n) {
+  // check maximimum exhaustive search size
+  if ((algo == algo_choice::exh) && (n >= 32)) {
+    std::cout << "error: exhaustive search is limited to n < 32" << std::endl;
+    return false;
+  }
+  if ((algo == algo_choice::mitm) && (n > 64)) {
+    std::cout << "error: meet-in-the-middle search is limited to n <= 64" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+const char* algo_name(algo_choice algo) {
   switch (algo) {
+  case algo_choice::exh:
+    return "exh";
+  case algo_choice::mitm:
+    return "mitm";
+  default:
+    return "dyn";
+  }
+}
+
+// Run algo on field, counting into stats when it is given. The result is
+// wide enough for every meet-in-the-middle count, which stays below 2^63.
+long long run_algo(algo_choice algo, const std::vector<std::string>& field,
+                   algorithms::SolveStats* stats = nullptr) {
+  switch (algo) {
+  case algo_choice::exh:
+    return stats ? algorithms::soccer_exhaustive(field, *stats)
+                 : algorithms::soccer_exhaustive(field);
+  case algo_choice::mitm:
+    return algorithms::soccer_exhaustive_mitm(field);
+  default:
+    return stats ? algorithms::soccer_dyn_prog(field, *stats)
+                 : algorithms::soccer_dyn_prog(field);
+  }
+}
+
+// Print the solver counters of one run of algo.
+void print_stats(algo_choice algo, const algorithms::SolveStats& stats) {
+  if (!algorithms::SolveStats::ENABLED) {
+    std::cout << "(solver counters compiled out, build with make STATS=1)" << std::endl;
+    return;
+  }
+  switch (algo) {
+  case algo_choice::exh:
+    std::cout << "candidates generated=" << stats.candidates_generated
+              << " killed by X=" << stats.candidates_killed_by_obstacle
+              << " killed leaving grid=" << stats.candidates_killed_leaving_grid
+              << std::endl
+              << "average prefix depth=" << stats.average_prefix_depth()
+              << " moves" << std::endl;
+    break;
   case algo_choice::dyn:
-    std::cout << "dyn";
+    std::cout << "cells visited=" << stats.cells_visited
+              << " obstacle cells skipped=" << stats.obstacle_cells_skipped
+              << " peak workspace=" << stats.peak_workspace_bytes << " bytes"
+              << std::endl;
     break;
-  case algo_choice::exh:
-    std::cout << "exh";
+  default:
     break;
   }
+}
+
+// Print how soccer_dyn_prog_batch compares to one soccer_dyn_prog call per
+// field on count random fields.
+void report_batch(size_t n, size_t count) {
+
+  std::vector<std::vector<std::string>> fields;
+  for (size_t k = 0; k < count; ++k) {
+    fields.push_back(make_random_field(n, time(0) + k));
+  }
+  std::vector<algorithms::BatchCount> out;
+
+  print_bar();
+  std::cout << "algo = batch dyn" << std::endl
+            << "n = " << n << " (" << fields[0].size() << "x"
+            << fields[0][0].size() << "), " << count << " fields" << std::endl;
+
+  Timer timer;
+  long long checksum = 0;
+  for (auto& field : fields) {
+    checksum += algorithms::soccer_dyn_prog(field);
+  }
+  double single = timer.elapsed();
+
+  timer.reset();
+  size_t solved = algorithms::soccer_dyn_prog_batch(fields, out);
+  double batch = timer.elapsed();
+
+  std::cout << "one call per field: " << count / single << " fields/s"
+            << " (checksum " << checksum << ")" << std::endl
+            << "batch:              " << count / batch << " fields/s"
+            << " (" << solved << " solved)" << std::endl;
+
+  print_bar();
+}
+
+// Print how soccer_dyn_prog_parallel scales from 1 to max_threads threads.
+void report_scaling(size_t n, size_t max_threads) {
+
+  // counts of random fields overflow quickly, so count modulo a prime
+  const std::uint64_t MODULUS = 1000000007;
+
+  auto field = make_random_field(n);
+  algorithms::PackedField packed(field);
+
+  print_bar();
+  std::cout << "algo = parallel dyn" << std::endl
+            << "n = " << n << " (" << packed.rows() << "x" << packed.columns()
+            << ")" << std::endl
+            << "threads  elapsed(s)  speedup  efficiency  solution" << std::endl;
+
+  Timer timer;
+  double baseline = 0;
+  for (size_t threads = 1; threads <= max_threads; ++threads) {
+    timer.reset();
+    std::uint64_t solution =
+      algorithms::soccer_dyn_prog_parallel(packed, threads, MODULUS);
+    double elapsed = timer.elapsed();
+    if (threads == 1) {
+      baseline = elapsed;
+    }
+    double speedup = baseline / elapsed;
+    std::cout << std::setw(7) << threads << "  "
+              << std::setw(10) << elapsed << "  "
+              << std::setw(7) << speedup << "  "
+              << std::setw(10) << speedup / threads << "  "
+              << solution << std::endl;
+  }
+
+  print_bar();
+}
+
+// Settings of the sweep report.
+struct sweep_options {
+  algo_choice algo;
+  size_t min_n, max_n;
+  // n grows by multiplying it by factor when it is positive, otherwise by
+  // adding increment
+  double factor{2};
+  size_t increment{0};
+  size_t reps{DEFAULT_SWEEP_REPS}, warmup{DEFAULT_SWEEP_WARMUP};
+  std::uint64_t seed;
+  std::string csv_path;
+};
+
+// Parse the sweep report arguments argv[2..argc). Prints an error and the
+// usage and returns false if they are invalid.
+bool parse_sweep(int argc, char* argv[], sweep_options& options) {
+  if (argc < 5 || (argc - 5) % 2 != 0) {
+    print_usage();
+    return false;
+  }
+  if (!parse_algo(argv[2], options.algo) ||
+      !parse_size("<MIN_N>", argv[3], MIN_N, options.min_n) ||
+      !parse_size("<MAX_N>", argv[4], options.min_n, options.max_n)) {
+    return false;
+  }
+  options.seed = time(0);
+  for (int k = 5; k < argc; k += 2) {
+    std::string flag{argv[k]}, value{argv[k + 1]};
+    if (flag == "--step") {
+      bool valid = value.size() >= 2 && (value[0] == 'x' || value[0] == '+');
+      try {
+        if (valid && value[0] == 'x') {
+          options.factor = std::stod(value.substr(1));
+          valid = options.factor > 1;
+        } else if (valid) {
+          options.factor = 0;
+          valid = parse_size("<K>", value.substr(1), 1, options.increment);
+        }
+      } catch (std::exception& e) {
+        valid = false;
+      }
+      if (!valid) {
+        std::cout << "error: --step must be x<K> with K > 1, or +<K> with K >= 1"
+                  << std::endl << std::endl;
+        print_usage();
+        return false;
+      }
+    } else if (flag == "--reps") {
+      if (!parse_size("<R>", value, 1, options.reps)) {
+        return false;
+      }
+    } else if (flag == "--warmup") {
+      if (!parse_size("<W>", value, 0, options.warmup)) {
+        return false;
+      }
+    } else if (flag == "--seed") {
+      size_t seed;
+      if (!parse_size("<S>", value, 0, seed)) {
+        return false;
+      }
+      options.seed = seed;
+    } else if (flag == "--csv") {
+      options.csv_path = value;
+    } else {
+      std::cout << "error: unknown option \"" << flag << "\""
+                << std::endl << std::endl;
+      print_usage();
+      return false;
+    }
+  }
+  return check_algo_size(options.algo, options.max_n);
+}
+
+// Summary of the repeated timings of one n.
+struct sweep_row {
+  size_t n, rows, columns;
+  double min, median, p95, mean, stddev;
+  long long solution;
+};
+
+// Least squares fit of y = a + slope * x, returning slope and the
+// coefficient of determination r_squared.
+void fit_line(const std::vector<double>& x, const std::vector<double>& y,
+              double& slope, double& r_squared) {
+  const double count = x.size();
+  double mean_x = 0, mean_y = 0;
+  for (size_t k = 0; k < x.size(); ++k) {
+    mean_x += x[k] / count;
+    mean_y += y[k] / count;
+  }
+  double sxx = 0, sxy = 0, syy = 0;
+  for (size_t k = 0; k < x.size(); ++k) {
+    sxx += (x[k] - mean_x) * (x[k] - mean_x);
+    sxy += (x[k] - mean_x) * (y[k] - mean_y);
+    syy += (y[k] - mean_y) * (y[k] - mean_y);
+  }
+  slope = sxy / sxx;
+  r_squared = (syy == 0) ? 1 : (sxy * sxy) / (sxx * syy);
+}
+
+// Time options.algo on one random field per n, and print the statistics,
+// the growth fits and the CSV.
+void report_sweep(const sweep_options& options) {
+
+  print_bar();
+  std::cout << "algo = " << algo_name(options.algo) << ", "
+            << options.reps << " reps after " << options.warmup
+            << " warmup runs, seed " << options.seed << std::endl
+            << "       n      min(s)   median(s)      p95(s)   stddev(s)  solution"
+            << std::endl;
+
+  std::vector<sweep_row> rows;
+  std::vector<double> times(options.reps);
+  Timer timer;
+  for (size_t n = options.min_n; n <= options.max_n; ) {
+    // every n has its own field, the same for the same seed
+    auto field = make_random_field(n, options.seed + n);
+    long long solution = 0;
+    for (size_t k = 0; k < options.warmup; ++k) {
+      solution = run_algo(options.algo, field);
+    }
+    for (auto& time : times) {
+      timer.reset();
+      solution = run_algo(options.algo, field);
+      time = timer.elapsed();
+    }
+
+    std::sort(times.begin(), times.end());
+    sweep_row row{n, field.size(), field[0].size()};
+    const size_t reps = times.size();
+    row.min = times.front();
+    row.median = (times[(reps - 1) / 2] + times[reps / 2]) / 2;
+    // nearest rank
+    row.p95 = times[std::min(reps - 1, size_t(std::ceil(0.95 * reps)) - 1)];
+    row.mean = 0;
+    for (double time : times) {
+      row.mean += time / reps;
+    }
+    double variance = 0;
+    for (double time : times) {
+      variance += (time - row.mean) * (time - row.mean);
+    }
+    row.stddev = (reps > 1) ? std::sqrt(variance / (reps - 1)) : 0;
+    row.solution = solution;
+    rows.push_back(row);
+
+    std::cout << std::setw(8) << n << std::scientific << std::setprecision(3)
+              << std::setw(12) << row.min << std::setw(12) << row.median
+              << std::setw(12) << row.p95 << std::setw(12) << row.stddev
+              << std::defaultfloat << std::setprecision(6)
+              << "  " << solution << std::endl;
+
+    size_t next = (options.factor > 0) ? size_t(std::llround(n * options.factor))
+                                       : n + options.increment;
+    n = std::max(next, n + 1);
+  }
+
+  // Fit the medians to c * n^k, a line in (log n, log t), and to c * b^n,
+  // a line in (n, log t). Quadratic algorithms should fit the first with
+  // k near 2, exponential ones the second with b near 2.
+  if (rows.size() >= 2) {
+    std::vector<double> log_n, n, log_t;
+    for (auto& row : rows) {
+      log_n.push_back(std::log(double(row.n)));
+      n.push_back(double(row.n));
+      log_t.push_back(std::log(row.median));
+    }
+    double k, k_r_squared, log_b, b_r_squared;
+    fit_line(log_n, log_t, k, k_r_squared);
+    fit_line(n, log_t, log_b, b_r_squared);
+    std::cout << "polynomial fit:  t ~ n^" << k
+              << "  (R^2 = " << k_r_squared << ")" << std::endl
+              << "exponential fit: t ~ " << std::exp(log_b) << "^n"
+              << "  (R^2 = " << b_r_squared << ")" << std::endl
+              << "better fit: "
+              << ((k_r_squared >= b_r_squared) ? "polynomial" : "exponential")
+              << std::endl;
+  }
+
+  std::ofstream file;
+  if (!options.csv_path.empty()) {
+    file.open(options.csv_path);
+    if (!file) {
+      std::cout << "error: cannot write " << options.csv_path << std::endl;
+    }
+  } else {
+    print_bar();
+  }
+  std::ostream& csv = options.csv_path.empty() ? std::cout : file;
+  csv << "algo,n,rows,columns,reps,min_s,median_s,p95_s,mean_s,stddev_s,solution"
+      << std::endl << std::setprecision(9);
+  for (auto& row : rows) {
+    csv << algo_name(options.algo) << ',' << row.n << ',' << row.rows << ','
+        << row.columns << ',' << options.reps << ',' << row.min << ','
+        << row.median << ',' << row.p95 << ',' << row.mean << ','
+        << row.stddev << ',' << row.solution << std::endl;
+  }
+  std::cout << std::setprecision(6);
+
+  print_bar();
+}
+
+int main(int argc, char* argv[]) {
+
+  // Exit codes
+  const int SUCCESS = 0, USAGE_ERROR = 1;
+
+  // The scaling report has its own arguments.
+  if ((argc == 3 || argc == 4) && std::string(argv[1]) == "scale") {
+    size_t n, max_threads = std::max(1u, std::thread::hardware_concurrency());
+    if (!parse_size("<N>", argv[2], MIN_N, n) ||
+        ((argc == 4) && !parse_size("<THREADS>", argv[3], 1, max_threads))) {
+      return USAGE_ERROR;
+    }
+    report_scaling(n, max_threads);
+    return SUCCESS;
+  }
+
+  // So does the batch throughput report.
+  if ((argc == 3 || argc == 4) && std::string(argv[1]) == "batch") {
+    size_t n, count = DEFAULT_BATCH_FIELDS;
+    if (!parse_size("<N>", argv[2], MIN_N, n) ||
+        ((argc == 4) && !parse_size("<FIELDS>", argv[3], 1, count))) {
+      return USAGE_ERROR;
+    }
+    report_batch(n, count);
+    return SUCCESS;
+  }
+
+  // And the sweep report.
+  if (argc >= 2 && std::string(argv[1]) == "sweep") {
+    sweep_options options;
+    if (!parse_sweep(argc, argv, options)) {
+      return USAGE_ERROR;
+    }
+    report_sweep(options);
+    return SUCCESS;
+  }
+
+  // First, try to parse commandline arguments for algo choice and n.
+  algo_choice algo;
+  size_t n;
+  
+  if (argc != 3) {
+    print_usage();
+    return USAGE_ERROR;
+  }
+
+  std::string algo_str{argv[1]},
+    n_str{argv[2]};
+
+  if (!parse_algo(algo_str, algo) ||
+      !parse_size("<N>", n_str, MIN_N, n)) {
+    return USAGE_ERROR;
+  }
+
+  // n should be initialized
+  assert(n >= MIN_N);
+
+  if (!check_algo_size(algo, n)) {
+    return USAGE_ERROR;
+  }
+
+  // build a grid
+  auto field = make_random_field(n);
+  size_t r = field.size();
   
-  std::cout << std::endl
+  // prepare to run algorithm with a cycle-accurate timer that also counts
+  // hardware events, and collect the algorithm's phase times
+  Timer timer(TimerMode::cycles, true);  // see timer.hpp
+  double elapsed; // elapsed time in seconds
+  PhaseTimes phases;
+  algorithms::SolveStats stats;
+
+  print_bar();
+  std::cout << "algo = " << algo_name(algo) << std::endl
       	    << "n = " << n << std::endl;
 
   if (r > MAX_PREVIEW_ROWS) {
@@ -155,25 +573,41 @@ int main(int argc, char* argv[]) {
   // run the algorithm
   // note that there is no input/output while the timer is running
   
+  PhaseTimer::collect(&phases);
   timer.reset();
   
-  int solution;
-  switch (algo) {
-  case algo_choice::dyn:
-    solution = algorithms::soccer_dyn_prog(field);
-    break;
-  case algo_choice::exh:
-    solution = algorithms::soccer_exhaustive(field);
-    break;
-  }
+  long long solution = run_algo(algo, field, &stats);
 
   elapsed = timer.elapsed();
+  std::uint64_t ticks = timer.elapsed_ticks();
+  PerfSample events = timer.counters();
+  PhaseTimer::collect(nullptr);
 
   // end of timing
 
   std::cout << "solution = " << solution << std::endl;
 
-  std::cout << "elapsed time=" << elapsed << " seconds" << std::endl;
+  std::cout << "elapsed time=" << elapsed << " seconds"
+            << " (" << ticks << " TSC ticks)" << std::endl;
+
+  std::cout << "phases: validation=" << phases[Phase::validation]
+            << " allocation=" << phases[Phase::allocation]
+            << " compute=" << phases[Phase::compute] << " seconds" << std::endl;
+
+  double cells = double(r) * field[0].size();
+  if (timer.has_counters()) {
+    std::cout << "instructions=" << events.instructions
+              << " cycles=" << events.cycles
+              << " IPC=" << events.ipc() << std::endl
+              << "cache misses/cell=" << events.cache_misses / cells
+              << " branch misses/cell=" << events.branch_misses / cells
+              << std::endl;
+  } else {
+    std::cout << "(hardware counters unavailable, see "
+              << "/proc/sys/kernel/perf_event_paranoid)" << std::endl;
+  }
+
+  print_stats(algo, stats);
 
   print_bar();
 